@@ -0,0 +1,387 @@
+// Microbenchmarks of each compiler phase on generated MiniJava programs,
+// from a few dozen lines to a few hundred thousand. Every benchmark takes
+// the program's approximate line count as its argument and reports its rate
+// in source bytes and in the units its phase works in: tokens, syntax tree
+// nodes or IR instructions. A phase's input is built once per size by the
+// phases before it, outside the timing.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "ast/Node.h"
+#include "bytecode/BytecodeProgram.hpp"
+#include "ir/CFG.hpp"
+#include "ir/IRGenerationVisitor.hpp"
+#include "ir/passes/ConditionalJumpFoldingPass.hpp"
+#include "ir/passes/ConstantFoldingPass.hpp"
+#include "ir/passes/IRPass.hpp"
+#include "lexing/Lexer.hpp"
+#include "lexing/StringViewStream.hpp"
+#include "parsing/Parser.hpp"
+#include "semantic/SymbolTable.hpp"
+#include "semantic/SymbolTableVisitor.hpp"
+#include "semantic/TypeCheckVisitor.hpp"
+
+namespace {
+
+constexpr int methodsPerClass = 10;
+
+// One method of about 26 lines: loops, branches, array accesses, calls and
+// constant expressions for the folding passes to find.
+void appendMethod(std::string &out, int index) {
+    const auto name = "m" + std::to_string(index);
+    const auto callee = index == 0 ? name : "m" + std::to_string(index - 1);
+    out += "  public int " + name + "(int n) {\n"
+           "    int i;\n"
+           "    int s;\n"
+           "    boolean b;\n"
+           "    i = 0;\n"
+           "    s = 2 * 3 + n;\n"
+           "    arr = new int[10];\n"
+           "    b = 1 < 2;\n"
+           "    while (i < 10) {\n"
+           "      arr[i] = s * i - (i / 2);\n"
+           "      if (b && (s < 100)) {\n"
+           "        s = s + arr[i];\n"
+           "      } else {\n"
+           "        s = s - 1;\n"
+           "      }\n"
+           "      i = i + 1;\n"
+           "    }\n"
+           "    f = s;\n"
+           "    if (2 < 1) {\n"
+           "      s = this." + callee + "(s);\n"
+           "    } else {\n"
+           "      s = s + arr.length;\n"
+           "    }\n"
+           "    return s;\n"
+           "  }\n\n";
+}
+
+// A valid program of at least about the given number of lines.
+std::string generateProgram(std::int64_t lines) {
+    const auto methods = std::max<std::int64_t>(1, lines / 26);
+    std::string out = "public class Main {\n"
+                      "  public static void main(String[] a) {\n"
+                      "    System.out.println(new C0().m0(1));\n"
+                      "  }\n"
+                      "}\n";
+    for (std::int64_t method = 0; method < methods; method++) {
+        if (method % methodsPerClass == 0) {
+            if (method != 0) {
+                out += "}\n";
+            }
+            out += "\nclass C" + std::to_string(method / methodsPerClass) +
+                   " {\n  int f;\n  int[] arr;\n\n";
+        }
+        appendMethod(out, static_cast<int>(method % methodsPerClass));
+    }
+    out += "}\n";
+    return out;
+}
+
+const std::string &programOfSize(std::int64_t lines) {
+    static std::map<std::int64_t, std::string> programs;
+    auto &program = programs[lines];
+    if (program.empty()) {
+        program = generateProgram(lines);
+    }
+    return program;
+}
+
+lexing::Lexer makeLexer(const std::string &source) {
+    return {std::make_unique<lexing::StringViewStream>(source), source};
+}
+
+std::unique_ptr<Node> parse(const std::string &source) {
+    parsing::Parser parser(makeLexer(source), nullptr);
+    auto result = parser.parse_goal();
+    return result.has_value() ? std::move(result.value()) : nullptr;
+}
+
+std::int64_t countNodes(const Node &node) {
+    std::int64_t count = 1;
+    for (const auto &child : node.children) {
+        count += countNodes(*child);
+    }
+    return count;
+}
+
+std::int64_t countInstructions(const CFG &graph) {
+    std::int64_t count = 0;
+    std::unordered_set<BBlock *> seen;
+    std::vector<BBlock *> pending(graph.getMethodRoots().begin(),
+                                  graph.getMethodRoots().end());
+    while (!pending.empty()) {
+        auto *block = pending.back();
+        pending.pop_back();
+        if (!seen.insert(block).second) {
+            continue;
+        }
+        count += static_cast<std::int64_t>(block->getInstructions().size());
+        for (auto *next : {block->getTrueBlock(), block->getFalseBlock()}) {
+            if (next != nullptr) {
+                pending.push_back(next);
+            }
+        }
+    }
+    return count;
+}
+
+// A program taken as far as the phase being measured needs.
+struct Frontend {
+    const std::string &source;
+    std::unique_ptr<Node> root;
+    std::int64_t nodes = 0;
+    SymbolTable table;
+    TypeInfo types;
+
+    explicit Frontend(const std::string &source_) : source(source_) {}
+    bool parse() {
+        root = ::parse(source);
+        nodes = root != nullptr ? countNodes(*root) : 0;
+        return root != nullptr;
+    }
+    bool analyze() {
+        return parse() && build_symbol_table(*root, table).ok() &&
+               check_types(*root, table, &types).ok();
+    }
+    // IR for the program, with the passes before the one at stopBefore run.
+    std::unique_ptr<CFG> generateIR(size_t stopBefore = 0);
+};
+
+// The passes CompilationSession runs, in its order.
+std::vector<std::unique_ptr<IRPass>> makePasses() {
+    std::vector<std::unique_ptr<IRPass>> passes;
+    passes.push_back(std::make_unique<ConstantFoldingPass>());
+    passes.push_back(std::make_unique<ConditionalJumpFoldingPass>());
+    return passes;
+}
+
+std::unique_ptr<CFG> Frontend::generateIR(size_t stopBefore) {
+    auto graph = std::make_unique<CFG>();
+    graph->setTypeInfo(&types);
+    if (!generate_ir(*root, *graph, table).ok()) {
+        return nullptr;
+    }
+    const auto passes = makePasses();
+    for (size_t i = 0; i < stopBefore; i++) {
+        (void)passes[i]->run(*graph);
+    }
+    return graph;
+}
+
+void setRates(benchmark::State &state, std::int64_t bytes, const char *unit,
+              std::int64_t units) {
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters[unit] = benchmark::Counter(
+        static_cast<double>(units),
+        benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["lines"] = static_cast<double>(state.range(0));
+}
+
+void BM_Lex(benchmark::State &state) {
+    const auto &source = programOfSize(state.range(0));
+    std::int64_t tokens = 0;
+    for (auto _ : state) {
+        auto lexer = makeLexer(source);
+        tokens = 0;
+        while (lexer.next().kind != lexing::TokenKind::Eof) {
+            tokens++;
+        }
+        benchmark::DoNotOptimize(tokens);
+    }
+    setRates(state, static_cast<std::int64_t>(source.size()), "tokens",
+             tokens);
+}
+
+void BM_Parse(benchmark::State &state) {
+    const auto &source = programOfSize(state.range(0));
+    std::int64_t nodes = 0;
+    for (auto _ : state) {
+        auto root = parse(source);
+        if (root == nullptr) {
+            state.SkipWithError("the generated program does not parse");
+            return;
+        }
+        state.PauseTiming();
+        nodes = countNodes(*root);
+        // Freeing the tree is not parsing.
+        root.reset();
+        state.ResumeTiming();
+    }
+    setRates(state, static_cast<std::int64_t>(source.size()), "nodes", nodes);
+}
+
+void BM_BuildSymbolTable(benchmark::State &state) {
+    Frontend program(programOfSize(state.range(0)));
+    if (!program.parse()) {
+        state.SkipWithError("the generated program does not parse");
+        return;
+    }
+    for (auto _ : state) {
+        SymbolTable table;
+        if (!build_symbol_table(*program.root, table).ok()) {
+            state.SkipWithError("build_symbol_table failed");
+            return;
+        }
+        benchmark::DoNotOptimize(table);
+    }
+    setRates(state, static_cast<std::int64_t>(program.source.size()), "nodes",
+             program.nodes);
+}
+
+void BM_CheckTypes(benchmark::State &state) {
+    Frontend program(programOfSize(state.range(0)));
+    if (!program.parse() || !build_symbol_table(*program.root, program.table)
+                                 .ok()) {
+        state.SkipWithError("the generated program does not compile");
+        return;
+    }
+    for (auto _ : state) {
+        TypeInfo types;
+        if (!check_types(*program.root, program.table, &types).ok()) {
+            state.SkipWithError("check_types failed");
+            return;
+        }
+        benchmark::DoNotOptimize(types);
+    }
+    setRates(state, static_cast<std::int64_t>(program.source.size()), "nodes",
+             program.nodes);
+}
+
+void BM_GenerateIR(benchmark::State &state) {
+    Frontend program(programOfSize(state.range(0)));
+    if (!program.analyze()) {
+        state.SkipWithError("the generated program does not compile");
+        return;
+    }
+    for (auto _ : state) {
+        CFG graph;
+        graph.setTypeInfo(&program.types);
+        if (!generate_ir(*program.root, graph, program.table).ok()) {
+            state.SkipWithError("generate_ir failed");
+            return;
+        }
+        benchmark::DoNotOptimize(graph);
+    }
+    setRates(state, static_cast<std::int64_t>(program.source.size()), "nodes",
+             program.nodes);
+}
+
+// Passes change the graph they run on, so each iteration times one pass on
+// freshly generated IR.
+void BM_IRPass(benchmark::State &state, size_t index) {
+    Frontend program(programOfSize(state.range(0)));
+    if (!program.analyze()) {
+        state.SkipWithError("the generated program does not compile");
+        return;
+    }
+    const auto passes = makePasses();
+    std::int64_t instructions = 0;
+    for (auto _ : state) {
+        const auto graph = program.generateIR(index);
+        if (graph == nullptr) {
+            state.SkipWithError("generate_ir failed");
+            return;
+        }
+        instructions = countInstructions(*graph);
+        const auto start = std::chrono::steady_clock::now();
+        benchmark::DoNotOptimize(passes[index]->run(*graph));
+        state.SetIterationTime(std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count());
+    }
+    setRates(state, static_cast<std::int64_t>(program.source.size()),
+             "instructions", instructions);
+}
+
+std::int64_t serializedSize(const BytecodeProgram &bytecode) {
+    std::ostringstream os;
+    bytecode.serialize(os);
+    return static_cast<std::int64_t>(os.tellp());
+}
+
+void BM_GenerateBytecode(benchmark::State &state) {
+    Frontend program(programOfSize(state.range(0)));
+    const auto graph = program.analyze()
+                           ? program.generateIR(makePasses().size())
+                           : nullptr;
+    if (graph == nullptr) {
+        state.SkipWithError("the generated program does not compile");
+        return;
+    }
+    std::int64_t bytes = 0;
+    for (auto _ : state) {
+        BytecodeProgram bytecode;
+        graph->generateBytecode(bytecode, program.table);
+        state.PauseTiming();
+        bytes = serializedSize(bytecode);
+        state.ResumeTiming();
+    }
+    // Bytes of bytecode generated, rather than of source.
+    setRates(state, bytes, "instructions", countInstructions(*graph));
+}
+
+void BM_Serialize(benchmark::State &state) {
+    Frontend program(programOfSize(state.range(0)));
+    const auto graph = program.analyze()
+                           ? program.generateIR(makePasses().size())
+                           : nullptr;
+    if (graph == nullptr) {
+        state.SkipWithError("the generated program does not compile");
+        return;
+    }
+    BytecodeProgram bytecode;
+    graph->generateBytecode(bytecode, program.table);
+    const auto bytes = serializedSize(bytecode);
+    for (auto _ : state) {
+        std::ostringstream os;
+        bytecode.serialize(os);
+        benchmark::DoNotOptimize(os);
+    }
+    setRates(state, bytes, "instructions", countInstructions(*graph));
+}
+
+void sizes(benchmark::internal::Benchmark *benchmark) {
+    benchmark->RangeMultiplier(10)->Range(10, 100000)->Arg(300000);
+    benchmark->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK(BM_Lex)->Apply(sizes);
+BENCHMARK(BM_Parse)->Apply(sizes);
+BENCHMARK(BM_BuildSymbolTable)->Apply(sizes);
+BENCHMARK(BM_CheckTypes)->Apply(sizes);
+BENCHMARK(BM_GenerateIR)->Apply(sizes);
+BENCHMARK(BM_GenerateBytecode)->Apply(sizes);
+BENCHMARK(BM_Serialize)->Apply(sizes);
+
+} // namespace
+
+int main(int argc, char **argv) {
+    // One benchmark per IR pass, named after it.
+    const auto passes = makePasses();
+    for (size_t i = 0; i < passes.size(); i++) {
+        const auto name = "BM_IRPass/" + std::string(passes[i]->name());
+        benchmark::RegisterBenchmark(name.c_str(), BM_IRPass, i)
+            ->Apply(sizes)
+            ->UseManualTime();
+    }
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
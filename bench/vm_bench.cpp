@@ -0,0 +1,358 @@
+// Runs the MiniJava programs in bench/workloads on the VM and reports, for
+// each, its wall time, bytecode instructions per second, allocations and
+// peak memory as JSON on standard output.
+//
+// Each workload's main method passes __SIZE__ to the code it measures; the
+// benchmark substitutes the workload's default size times --scale. Every
+// workload is compiled once, run once with instruction counting (which
+// turns the JIT off) and then timed over --repetitions runs with the VM
+// flags given. Instructions per second divides the counted instructions by
+// the median timed run, so with the JIT it is the rate of the bytecode the
+// compiled code stands in for.
+//
+// Each workload runs in a child process of its own, so that its peak
+// resident memory is not that of the workloads before it.
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "driver/CompilationSession.hpp"
+#include "util/Json.hpp"
+#include "vm/Interpreter.hpp"
+
+namespace {
+
+struct Workload {
+    std::string_view name;
+    // What __SIZE__ means is up to the workload: elements to sort or
+    // insert, the sieve's limit, the matrices' order or the call depth.
+    long defaultSize;
+};
+
+constexpr std::array workloads = {
+    Workload{"BubbleSort", 1500},     Workload{"QuickSort", 100000},
+    Workload{"BinaryTree", 10000},    Workload{"LinkedList", 5000},
+    Workload{"Sieve", 1000000},       Workload{"MatrixMultiply", 60},
+    Workload{"Recursion", 10000},
+};
+
+struct BenchOptions {
+    double scale = 1.0;
+    unsigned repetitions = 5;
+    std::vector<std::string_view> only;
+    VmOptions vm;
+};
+
+struct Result {
+    const Workload *workload;
+    long size;
+    std::string output;
+    std::vector<std::chrono::nanoseconds> times;
+    // The counting run's instructions and the last timed run's stats.
+    std::uint64_t instructions;
+    VmRunStats stats;
+};
+
+template <typename T> std::optional<T> parseNumber(std::string_view text) {
+    T value{};
+    const auto [end, error] =
+        std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc{} || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<std::string> readWorkload(std::string_view name) {
+    const auto path = std::filesystem::path(VM_BENCH_WORKLOADS) /
+                      (std::string(name) + ".java");
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+    return std::string(std::istreambuf_iterator<char>(file), {});
+}
+
+// Compiles and runs one workload; reports why and returns nothing if it
+// does not compile or run cleanly.
+std::optional<Result> runWorkload(const Workload &workload,
+                                  const BenchOptions &options) {
+    auto source = readWorkload(workload.name);
+    if (!source.has_value()) {
+        std::cerr << "Error: Unable to read workload " << workload.name
+                  << ".\n";
+        return std::nullopt;
+    }
+    const auto size = std::max(
+        1L, std::lround(static_cast<double>(workload.defaultSize) *
+                        options.scale));
+    constexpr std::string_view placeholder = "__SIZE__";
+    if (const auto at = source->find(placeholder); at != std::string::npos) {
+        source->replace(at, placeholder.size(), std::to_string(size));
+    }
+
+    CompilationSession session(std::move(*source));
+    if (session.compile() != CompileStatus::Success) {
+        std::cerr << "Error: Workload " << workload.name
+                  << " does not compile.\n";
+        return std::nullopt;
+    }
+
+    Result result{.workload = &workload,
+                  .size = size,
+                  .output = {},
+                  .times = {},
+                  .instructions = 0,
+                  .stats = {}};
+    auto counting = options.vm;
+    counting.interpreter.countInstructions = true;
+    for (unsigned run = 0; run <= options.repetitions; run++) {
+        std::ostringstream out;
+        std::ostringstream err;
+        VmRunStats stats;
+        if (!runBytecodeProgram(session.getProgram(),
+                                run == 0 ? counting : options.vm, out, err,
+                                &stats) ||
+            !stats.completed) {
+            std::cerr << "Error: Workload " << workload.name
+                      << " failed:\n"
+                      << err.str();
+            return std::nullopt;
+        }
+        if (run == 0) {
+            result.output = std::move(out).str();
+            result.instructions = stats.instructions;
+            continue;
+        }
+        if (out.str() != result.output) {
+            std::cerr << "Error: Workload " << workload.name
+                      << " printed something different on run " << run
+                      << ".\n";
+            return std::nullopt;
+        }
+        result.times.push_back(stats.runTime);
+        result.stats = stats;
+    }
+    return result;
+}
+
+// Writes a workload's fields, without the enclosing braces or its peak
+// memory, which only the parent process knows.
+void writeWorkload(std::ostream &os, const Result &result) {
+    auto times = result.times;
+    std::ranges::sort(times);
+    const auto median = times[times.size() / 2];
+    const auto mean = std::accumulate(times.begin(), times.end(),
+                                      std::chrono::nanoseconds{0}) /
+                      times.size();
+    const auto &stats = result.stats;
+    os << "      \"name\": ";
+    writeJsonString(os, result.workload->name);
+    os << ",\n      \"size\": " << result.size << ",\n      \"output\": ";
+    writeJsonString(os, result.output);
+    os << ",\n      \"wall_time_ns\": {\"min\": " << times.front().count()
+       << ", \"median\": " << median.count() << ", \"mean\": " << mean.count()
+       << ", \"max\": " << times.back().count() << "}";
+    // Without the profiler the VM cannot count instructions.
+    if (result.instructions == 0) {
+        os << ",\n      \"instructions\": null"
+           << ",\n      \"instructions_per_second\": null";
+    } else {
+        const auto seconds = std::chrono::duration<double>(median).count();
+        os << ",\n      \"instructions\": " << result.instructions
+           << ",\n      \"instructions_per_second\": "
+           << std::llround(static_cast<double>(result.instructions) / seconds);
+    }
+    os << ",\n      \"heap\": {\"objects\": " << stats.objectsAllocated
+       << ", \"arrays\": " << stats.arraysAllocated
+       << ", \"bytes\": " << stats.heapBytesAllocated
+       << ", \"peak_bytes\": " << stats.peakHeapBytes
+       << ", \"collections\": " << stats.collections << "}"
+       << ",\n      \"native_entries\": " << stats.nativeEntries
+       << ",\n      \"host_allocations\": {\"count\": "
+       << stats.hostAllocations << ", \"bytes\": " << stats.hostAllocatedBytes
+       << "}";
+}
+
+// Runs the workload in a child process, which writes its fields to a pipe,
+// and adds the child's peak resident memory: ru_maxrss only ever grows, so
+// in one process every workload would report the largest before it. The
+// child starts as a copy of this process, whose own few megabytes count
+// towards the peak. Returns nothing if the workload failed.
+std::optional<std::string> runIsolated(const Workload &workload,
+                                       const BenchOptions &options) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cerr << "Error: Unable to create a pipe.\n";
+        return std::nullopt;
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    const pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Error: Unable to start a process for workload "
+                  << workload.name << ".\n";
+        close(fds[0]);
+        close(fds[1]);
+        return std::nullopt;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        const auto result = runWorkload(workload, options);
+        if (!result.has_value()) {
+            std::cerr.flush();
+            _exit(EXIT_FAILURE);
+        }
+        std::ostringstream fields;
+        writeWorkload(fields, *result);
+        const auto text = std::move(fields).str();
+        for (size_t written = 0; written < text.size();) {
+            const auto n =
+                write(fds[1], text.data() + written, text.size() - written);
+            if (n < 0 && errno != EINTR) {
+                _exit(EXIT_FAILURE);
+            }
+            written += n < 0 ? 0 : static_cast<size_t>(n);
+        }
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(fds[1]);
+    std::string fields;
+    std::array<char, 4096> buffer;
+    for (;;) {
+        const auto n = read(fds[0], buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        fields.append(buffer.data(), static_cast<size_t>(n));
+    }
+    close(fds[0]);
+
+    int status = 0;
+    rusage usage{};
+    while (wait4(pid, &status, 0, &usage) < 0) {
+        if (errno != EINTR) {
+            return std::nullopt;
+        }
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        if (WIFSIGNALED(status)) {
+            std::cerr << "Error: Workload " << workload.name
+                      << " was killed by signal " << WTERMSIG(status) << ".\n";
+        }
+        return std::nullopt;
+    }
+    // Linux reports ru_maxrss in KiB.
+    return fields + ",\n      \"peak_rss_kib\": " +
+           std::to_string(usage.ru_maxrss);
+}
+
+void writeResults(std::ostream &os, const BenchOptions &options,
+                  const std::vector<std::string> &results) {
+    os << "{\n  \"format\": 1,\n  \"scale\": " << options.scale
+       << ",\n  \"repetitions\": " << options.repetitions
+       << ",\n  \"workloads\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        os << (i == 0 ? "\n" : ",\n") << "    {\n" << results[i] << "\n    }";
+    }
+    os << "\n  ]\n}\n";
+}
+
+void printUsage(const char *program) {
+    std::cerr << "Usage: " << program
+              << " [--scale=FACTOR] [--repetitions=N] [--workload=NAME]... "
+              << vmFlagUsage << "\nWorkloads:";
+    for (const auto &workload : workloads) {
+        std::cerr << " " << workload.name;
+    }
+    std::cerr << "\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        try {
+            if (parseVmFlag(arg, options.vm)) {
+                continue;
+            }
+        } catch (const std::exception &exc) {
+            std::cerr << "Error: " << exc.what() << ".\n";
+            return EXIT_FAILURE;
+        }
+        if (arg.starts_with("--scale=")) {
+            // std::from_chars for double is not in every standard library
+            // yet.
+            char *end = nullptr;
+            const std::string text(arg.substr(8));
+            options.scale = std::strtod(text.c_str(), &end);
+            if (text.empty() || *end != '\0' || !(options.scale > 0)) {
+                std::cerr << "Error: Invalid scale " << text << ".\n";
+                return EXIT_FAILURE;
+            }
+        } else if (arg.starts_with("--repetitions=")) {
+            const auto repetitions = parseNumber<unsigned>(arg.substr(14));
+            if (!repetitions.has_value() || *repetitions == 0) {
+                std::cerr << "Error: Invalid repetitions " << arg.substr(14)
+                          << ".\n";
+                return EXIT_FAILURE;
+            }
+            options.repetitions = *repetitions;
+        } else if (arg.starts_with("--workload=")) {
+            const auto name = arg.substr(11);
+            if (std::ranges::find(workloads, name, &Workload::name) ==
+                workloads.end()) {
+                std::cerr << "Error: Unknown workload " << name << ".\n";
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            options.only.push_back(name);
+        } else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<std::string> results;
+    for (const auto &workload : workloads) {
+        if (!options.only.empty() &&
+            std::ranges::find(options.only, workload.name) ==
+                options.only.end()) {
+            continue;
+        }
+        auto result = runIsolated(workload, options);
+        if (!result.has_value()) {
+            return EXIT_FAILURE;
+        }
+        results.push_back(std::move(*result));
+    }
+    writeResults(std::cout, options, results);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+public class BinaryTree {
+  public static void main(String[] args) {
+    System.out.println(new Forest().run(__SIZE__));
+  }
+}
+
+class Forest {
+  public int run(int size) {
+    Tree root;
+    int i;
+    int seed;
+    int ignored;
+    root = new Tree();
+    seed = 1;
+    ignored = root.init(32768);
+    i = 1;
+    while (i < size) {
+      seed = seed * 75 + 74;
+      seed = seed - (seed / 65537) * 65537;
+      ignored = root.insert(seed);
+      i = i + 1;
+    }
+    return root.sum(1);
+  }
+}
+
+// Unbalanced binary search tree of keys; duplicates go right.
+class Tree {
+  int key;
+  boolean hasLeft;
+  boolean hasRight;
+  Tree left;
+  Tree right;
+
+  public int init(int k) {
+    key = k;
+    hasLeft = false;
+    hasRight = false;
+    return k;
+  }
+
+  public int insert(int k) {
+    Tree node;
+    Tree child;
+    boolean searching;
+    int ignored;
+    node = this;
+    searching = true;
+    while (searching) {
+      if (k < node.getKey()) {
+        if (node.getHasLeft()) {
+          node = node.getLeft();
+        } else {
+          child = new Tree();
+          ignored = child.init(k);
+          ignored = node.setLeft(child);
+          searching = false;
+        }
+      } else {
+        if (node.getHasRight()) {
+          node = node.getRight();
+        } else {
+          child = new Tree();
+          ignored = child.init(k);
+          ignored = node.setRight(child);
+          searching = false;
+        }
+      }
+    }
+    return k;
+  }
+
+  // The keys in order, each weighted by its depth.
+  public int sum(int depth) {
+    int total;
+    total = key * depth;
+    if (hasLeft) {
+      total = total + left.sum(depth + 1);
+    } else {
+    }
+    if (hasRight) {
+      total = total + right.sum(depth + 1);
+    } else {
+    }
+    return total;
+  }
+
+  public int getKey() {
+    return key;
+  }
+
+  public boolean getHasLeft() {
+    return hasLeft;
+  }
+
+  public boolean getHasRight() {
+    return hasRight;
+  }
+
+  public Tree getLeft() {
+    return left;
+  }
+
+  public Tree getRight() {
+    return right;
+  }
+
+  public int setLeft(Tree node) {
+    left = node;
+    hasLeft = true;
+    return 0;
+  }
+
+  public int setRight(Tree node) {
+    right = node;
+    hasRight = true;
+    return 0;
+  }
+}
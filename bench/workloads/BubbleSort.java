@@ -0,0 +1,70 @@
+public class BubbleSort {
+  public static void main(String[] args) {
+    System.out.println(new Sorter().run(__SIZE__));
+  }
+}
+
+class Sorter {
+  int[] numbers;
+
+  public int run(int size) {
+    int ignored;
+    ignored = this.fill(size);
+    ignored = this.sort();
+    return this.checksum();
+  }
+
+  public int fill(int size) {
+    int i;
+    int seed;
+    numbers = new int[size];
+    seed = 1;
+    i = 0;
+    while (i < size) {
+      seed = seed * 75 + 74;
+      seed = seed - (seed / 65537) * 65537;
+      numbers[i] = seed;
+      i = i + 1;
+    }
+    return size;
+  }
+
+  public int sort() {
+    int i;
+    int j;
+    int swap;
+    i = numbers.length - 1;
+    while (0 < i) {
+      j = 0;
+      while (j < i) {
+        if (numbers[j + 1] < numbers[j]) {
+          swap = numbers[j];
+          numbers[j] = numbers[j + 1];
+          numbers[j + 1] = swap;
+        } else {
+        }
+        j = j + 1;
+      }
+      i = i - 1;
+    }
+    return 0;
+  }
+
+  // Fails loudly, with -1, if the array is not sorted.
+  public int checksum() {
+    int i;
+    int sum;
+    sum = numbers[0];
+    i = 1;
+    while (i < numbers.length) {
+      if (numbers[i] < numbers[i - 1]) {
+        sum = 0 - 1;
+        i = numbers.length;
+      } else {
+        sum = sum + numbers[i] * i;
+        i = i + 1;
+      }
+    }
+    return sum;
+  }
+}
@@ -0,0 +1,78 @@
+public class LinkedList {
+  public static void main(String[] args) {
+    System.out.println(new Lists().run(__SIZE__));
+  }
+}
+
+class Lists {
+  // Builds a list of size elements and walks it 50 times.
+  public int run(int size) {
+    List list;
+    int i;
+    int total;
+    list = new List();
+    i = list.init();
+    i = 0;
+    while (i < size) {
+      list = list.prepend(i);
+      i = i + 1;
+    }
+    total = 0;
+    i = 0;
+    while (i < 50) {
+      total = total + list.sum();
+      i = i + 1;
+    }
+    return total;
+  }
+}
+
+class List {
+  int value;
+  List next;
+  boolean end;
+
+  public int init() {
+    end = true;
+    return 0;
+  }
+
+  public List prepend(int v) {
+    List node;
+    int ignored;
+    node = new List();
+    ignored = node.link(v, this);
+    return node;
+  }
+
+  public int link(int v, List rest) {
+    value = v;
+    next = rest;
+    end = false;
+    return v;
+  }
+
+  public int sum() {
+    List node;
+    int total;
+    node = this;
+    total = 0;
+    while (!node.isEnd()) {
+      total = total + node.getValue();
+      node = node.getNext();
+    }
+    return total;
+  }
+
+  public boolean isEnd() {
+    return end;
+  }
+
+  public int getValue() {
+    return value;
+  }
+
+  public List getNext() {
+    return next;
+  }
+}
@@ -0,0 +1,50 @@
+public class MatrixMultiply {
+  public static void main(String[] args) {
+    System.out.println(new Matrices().run(__SIZE__));
+  }
+}
+
+class Matrices {
+  // Multiplies two n by n matrices, stored row by row, and sums the
+  // product's diagonal.
+  public int run(int n) {
+    int[] a;
+    int[] b;
+    int[] c;
+    int i;
+    int j;
+    int k;
+    int sum;
+    a = new int[n * n];
+    b = new int[n * n];
+    c = new int[n * n];
+    i = 0;
+    while (i < n * n) {
+      a[i] = i - (i / 7) * 7;
+      b[i] = i - (i / 5) * 5 + 1;
+      i = i + 1;
+    }
+    i = 0;
+    while (i < n) {
+      j = 0;
+      while (j < n) {
+        sum = 0;
+        k = 0;
+        while (k < n) {
+          sum = sum + a[i * n + k] * b[k * n + j];
+          k = k + 1;
+        }
+        c[i * n + j] = sum;
+        j = j + 1;
+      }
+      i = i + 1;
+    }
+    sum = 0;
+    i = 0;
+    while (i < n) {
+      sum = sum + c[i * n + i];
+      i = i + 1;
+    }
+    return sum;
+  }
+}
@@ -0,0 +1,83 @@
+public class QuickSort {
+  public static void main(String[] args) {
+    System.out.println(new Sorter().run(__SIZE__));
+  }
+}
+
+class Sorter {
+  int[] numbers;
+
+  public int run(int size) {
+    int ignored;
+    ignored = this.fill(size);
+    ignored = this.sort(0, size - 1);
+    return this.checksum();
+  }
+
+  public int fill(int size) {
+    int i;
+    int seed;
+    numbers = new int[size];
+    seed = 1;
+    i = 0;
+    while (i < size) {
+      seed = seed * 75 + 74;
+      seed = seed - (seed / 65537) * 65537;
+      numbers[i] = seed;
+      i = i + 1;
+    }
+    return size;
+  }
+
+  // Hoare partitioning around the middle element.
+  public int sort(int left, int right) {
+    int pivot;
+    int i;
+    int j;
+    int swap;
+    int ignored;
+    if (left < right) {
+      pivot = numbers[(left + right) / 2];
+      i = left;
+      j = right;
+      while (!(j < i)) {
+        while (numbers[i] < pivot) {
+          i = i + 1;
+        }
+        while (pivot < numbers[j]) {
+          j = j - 1;
+        }
+        if (!(j < i)) {
+          swap = numbers[i];
+          numbers[i] = numbers[j];
+          numbers[j] = swap;
+          i = i + 1;
+          j = j - 1;
+        } else {
+        }
+      }
+      ignored = this.sort(left, j);
+      ignored = this.sort(i, right);
+    } else {
+    }
+    return 0;
+  }
+
+  // Fails loudly, with -1, if the array is not sorted.
+  public int checksum() {
+    int i;
+    int sum;
+    sum = numbers[0];
+    i = 1;
+    while (i < numbers.length) {
+      if (numbers[i] < numbers[i - 1]) {
+        sum = 0 - 1;
+        i = numbers.length;
+      } else {
+        sum = sum + numbers[i] * i;
+        i = i + 1;
+      }
+    }
+    return sum;
+  }
+}
@@ -0,0 +1,40 @@
+public class Recursion {
+  public static void main(String[] args) {
+    System.out.println(new Calls().run(__SIZE__));
+  }
+}
+
+class Calls {
+  // Recurses depth levels deep, 20 times over, plus a small Fibonacci.
+  public int run(int depth) {
+    int i;
+    int total;
+    total = 0;
+    i = 0;
+    while (i < 20) {
+      total = total + this.down(depth);
+      i = i + 1;
+    }
+    return total + this.fib(20);
+  }
+
+  public int down(int n) {
+    int result;
+    if (n < 1) {
+      result = 0;
+    } else {
+      result = this.down(n - 1) + n;
+    }
+    return result;
+  }
+
+  public int fib(int n) {
+    int result;
+    if (n < 2) {
+      result = n;
+    } else {
+      result = this.fib(n - 1) + this.fib(n - 2);
+    }
+    return result;
+  }
+}
@@ -0,0 +1,31 @@
+public class Sieve {
+  public static void main(String[] args) {
+    System.out.println(new Primes().count(__SIZE__));
+  }
+}
+
+class Primes {
+  // The number of primes below limit, by the sieve of Eratosthenes.
+  public int count(int limit) {
+    int[] composite;
+    int i;
+    int j;
+    int primes;
+    composite = new int[limit];
+    primes = 0;
+    i = 2;
+    while (i < limit) {
+      if (composite[i] == 0) {
+        primes = primes + 1;
+        j = i * i;
+        while (j < limit) {
+          composite[j] = 1;
+          j = j + i;
+        }
+      } else {
+      }
+      i = i + 1;
+    }
+    return primes;
+  }
+}
@@ -0,0 +1,14 @@
+#include "bytecode/BytecodeClass.hpp"
+
+void BytecodeClass::print(std::ostream &os) const {
+    os << "class " << name << ":\n";
+    for (size_t i = 0; i < fields.size(); i++) {
+        os << '\t' << i << '\t' << fields[i] << '\n';
+    }
+}
+
+void BytecodeClass::serialize(Serializer &serializer) const {
+    serializer.writeSymbol(name);
+    serializer.writeSymbolVector(fields);
+    serializer.writeKindVector(fieldKinds);
+}
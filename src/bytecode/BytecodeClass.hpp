@@ -0,0 +1,41 @@
+#ifndef BYTECODE_CLASS_HPP
+#define BYTECODE_CLASS_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "bytecode/ValueKind.hpp"
+#include "util/serialize.hpp"
+
+class BytecodeClass {
+    std::string name;
+    std::int64_t id;
+    // The position of a field in this vector is its slot in every object of
+    // the class.
+    std::vector<std::string> fields;
+    std::vector<ValueKind> fieldKinds;
+
+  public:
+    BytecodeClass(const std::string &name_, std::int64_t id_,
+                  std::vector<std::string> fields_,
+                  std::vector<ValueKind> fieldKinds_)
+        : name(name_), id(id_), fields(std::move(fields_)),
+          fieldKinds(std::move(fieldKinds_)) {};
+
+    bool operator==(const std::string &otherName) const {
+        return name == otherName;
+    }
+
+    [[nodiscard]] const std::string &getName() const { return name; }
+    [[nodiscard]] std::int64_t getId() const { return id; }
+    [[nodiscard]] const auto &getFields() const { return fields; }
+    [[nodiscard]] const auto &getFieldKinds() const { return fieldKinds; }
+
+    void print(std::ostream &os) const;
+
+    void serialize(Serializer &serializer) const;
+};
+
+#endif
@@ -6,6 +6,9 @@ void StackParameterInstruction::print(std::ostream &os) const {
 void IntegerParameterInstruction::print(std::ostream &os) const {
     os << mnemonic << '\t' << param << '\n';
 };
+void SlotInstruction::print(std::ostream &os) const {
+    os << mnemonic << '\t' << getParam() << '\t' << name << '\n';
+};
 void StringParameterInstruction::print(std::ostream &os) const {
     os << mnemonic << '\t' << param << '\n';
 };
@@ -19,5 +22,5 @@ void IntegerParameterInstruction::serialize(Serializer &serializer) const {
 };
 void StringParameterInstruction::serialize(Serializer &serializer) const {
     serializer.writeOpcode(opcode);
-    serializer.writeString(param);
+    serializer.writeSymbol(param);
 };
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <ostream>
+#include <string>
 #include <vector>
 
 #include "bytecode/Opcode.hpp"
@@ -12,6 +13,8 @@ class BytecodeInstruction {
   protected:
     Opcode opcode;
     std::string mnemonic;
+    // Source line the instruction was generated from; 0 if unknown.
+    int line = 0;
 
   public:
     BytecodeInstruction(Opcode opcode_)
@@ -23,6 +26,8 @@ class BytecodeInstruction {
     virtual void serialize(Serializer &serializer) const = 0;
 
     Opcode getOpcode() const { return opcode; }
+    [[nodiscard]] int getLine() const { return line; }
+    void setLine(int line_) { line = line_; }
 };
 
 class StackParameterInstruction : public BytecodeInstruction {
@@ -48,6 +53,18 @@ class IntegerParameterInstruction : public BytecodeInstruction {
     [[nodiscard]] std::int64_t getParam() const { return param; }
 };
 
+class SlotInstruction : public IntegerParameterInstruction {
+    // An instruction which addresses a method variable or a field of the
+    // receiver by its slot index. The name is kept for the textual listing.
+    std::string name;
+
+  public:
+    SlotInstruction(Opcode opcode_, std::int64_t slot_, const std::string &name_)
+        : IntegerParameterInstruction(opcode_, slot_), name(name_) {};
+    void print(std::ostream &os) const override;
+    [[nodiscard]] const std::string &getName() const { return name; }
+};
+
 class StringParameterInstruction : public BytecodeInstruction {
     // An instruction which takes one integer parameter
     // and pushes one result back to the stack
@@ -59,6 +76,7 @@ class StringParameterInstruction : public BytecodeInstruction {
     void print(std::ostream &os) const override;
 
     void serialize(Serializer &serializer) const override;
+    [[nodiscard]] const std::string &getParam() const { return param; }
 };
 
 #endif
@@ -2,10 +2,31 @@
 #include "bytecode/BytecodeMethodBlock.hpp"
 #include <algorithm>
 #include <iostream>
+#include <utility>
+
+BytecodeMethod::BytecodeMethod(const std::string &name_,
+                               std::vector<std::string> variables_,
+                               std::vector<ValueKind> variableKinds_,
+                               MethodSignature signature_,
+                               const BytecodeClass &owner)
+    : name(name_), variables(std::move(variables_)),
+      variableKinds(std::move(variableKinds_)),
+      signature(std::move(signature_)), classId(owner.getId()) {
+    auto variableSlots = std::make_shared<VariableSlots>();
+    for (size_t i = 0; i < variables.size(); i++) {
+        variableSlots->locals.emplace(variables[i],
+                                      static_cast<std::int64_t>(i));
+    }
+    const auto &fields = owner.getFields();
+    for (size_t i = 0; i < fields.size(); i++) {
+        variableSlots->fields.emplace(fields[i], static_cast<std::int64_t>(i));
+    }
+    slots = std::move(variableSlots);
+}
 
 BytecodeMethodBlock &
 BytecodeMethod::addBytecodeMethodBlock(const std::string &name) {
-    return blocks.emplace_back(name);
+    return blocks.emplace_back(name, slots);
 }
 
 [[nodiscard]] BytecodeMethodBlock &
@@ -23,13 +44,49 @@ void BytecodeMethod::print(std::ostream &os) const {
     }
 }
 
+void BytecodeMethod::serializeSignature(Serializer &serializer) const {
+    serializer.writeSignedInteger(classId);
+    serializer.writeKindVector(signature.parameters);
+    serializer.writeKindVector({signature.result});
+}
+
+// Lines are stored as runs of instructions, in code order, that share a
+// line: the length of the run, then the difference from the previous run's
+// line.
+bool BytecodeMethod::serializeLines(Serializer &serializer) const {
+    std::vector<std::pair<size_t, int>> runs;
+    bool known = false;
+    for (const auto &block : blocks) {
+        for (const auto &instruction : block.getInstructions()) {
+            const auto line = instruction->getLine();
+            known = known || line != 0;
+            if (!runs.empty() && runs.back().second == line) {
+                runs.back().first++;
+            } else {
+                runs.emplace_back(1, line);
+            }
+        }
+    }
+    if (!known) {
+        return false;
+    }
+    serializer.writeSymbol(name);
+    serializer.writeInteger(runs.size());
+    int previous = 0;
+    for (const auto &[length, line] : runs) {
+        serializer.writeInteger(length);
+        serializer.writeSignedInteger(line - previous);
+        previous = line;
+    }
+    return true;
+}
+
 void BytecodeMethod::serialize(Serializer &serializer) const {
-    serializer.writeString(name);
-    serializer.writeStringVector(variables);
-    serializer.writeStringVector(fieldVariables);
+    serializer.writeSymbolVector(variables);
+    serializer.writeKindVector(variableKinds);
     serializer.writeInteger(blocks.size());
     for (const auto &block : blocks) {
-        serializer.writeString(block.getName());
+        serializer.writeSymbol(block.getName());
         block.serialize(serializer);
     }
 }
@@ -1,8 +1,10 @@
 #ifndef BYTECODEMETHOD_HPP
 #define BYTECODEMETHOD_HPP
 
+#include "bytecode/BytecodeClass.hpp"
 #include "bytecode/BytecodeMethodBlock.hpp"
 #include "util/serialize.hpp"
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -10,15 +12,19 @@ class BytecodeMethod {
     std::vector<BytecodeMethodBlock> blocks;
 
     std::string name;
+    // Method variables (locals, parameters and temporaries); the position of
+    // a name in this vector is its local slot index. Slot 0 holds "this".
     std::vector<std::string> variables;
-    std::vector<std::string> fieldVariables;
+    std::vector<ValueKind> variableKinds;
+    MethodSignature signature;
+    std::int64_t classId;
+    std::shared_ptr<const VariableSlots> slots;
 
   public:
     BytecodeMethod(const std::string &name_,
                    std::vector<std::string> variables_,
-                   std::vector<std::string> fieldVariables_)
-        : name(name_), variables(std::move(variables_)),
-          fieldVariables(std::move(fieldVariables_)) {};
+                   std::vector<ValueKind> variableKinds_,
+                   MethodSignature signature_, const BytecodeClass &owner);
 
     bool operator==(const std::string &otherName) const {
         return name == otherName;
@@ -34,13 +40,22 @@ class BytecodeMethod {
 
     void print(std::ostream &os) const;
 
+    [[nodiscard]] const std::string &getName() const { return name; }
     [[nodiscard]] const auto &getBlocks() const { return blocks; }
     [[nodiscard]] const auto &getVariables() const { return variables; }
-    [[nodiscard]] const auto &getFieldVariables() const {
-        return fieldVariables;
+    [[nodiscard]] const auto &getVariableKinds() const {
+        return variableKinds;
     }
+    [[nodiscard]] const auto &getSignature() const { return signature; }
+    [[nodiscard]] std::int64_t getClassId() const { return classId; }
 
+    // The owning class and signature, which go in the method directory so
+    // that callers can be checked without reading the method's body.
+    void serializeSignature(Serializer &serializer) const;
     void serialize(Serializer &serializer) const;
+    // The method's entry in the line table. Returns false, writing nothing,
+    // if none of its instructions has a known line.
+    bool serializeLines(Serializer &serializer) const;
 };
 
 #endif // BYTECODEMETHOD_HPP
@@ -12,7 +12,16 @@ void BytecodeMethodBlock::print(std::ostream &os) const {
     }
 }
 
+namespace {
+[[nodiscard]] const std::int64_t *find_slot(const SlotMap &slots,
+                                            const std::string &name) {
+    const auto it = slots.find(name);
+    return it != slots.end() ? &it->second : nullptr;
+}
+} // namespace
+
 void BytecodeMethodBlock::addBytecodeInstruction(BytecodeInstruction *instr) {
+    instr->setLine(line);
     instructions.emplace_back(instr);
 }
 
@@ -21,15 +30,37 @@ BytecodeMethodBlock &BytecodeMethodBlock::push(const Operand &operand) {
         addBytecodeInstruction(
             new IntegerParameterInstruction(Opcode::CONST, *ptr));
     } else if (const auto *ptr = std::get_if<std::string>(&operand)) {
-        addBytecodeInstruction(
-            new StringParameterInstruction(Opcode::LOAD, *ptr));
+        if (slots == nullptr) {
+            addBytecodeInstruction(
+                new StringParameterInstruction(Opcode::LOAD, *ptr));
+        } else if (const auto *slot = find_slot(slots->locals, *ptr)) {
+            addBytecodeInstruction(
+                new SlotInstruction(Opcode::LOAD_LOCAL, *slot, *ptr));
+        } else if (const auto *field = find_slot(slots->fields, *ptr)) {
+            addBytecodeInstruction(
+                new SlotInstruction(Opcode::GETFIELD, *field, *ptr));
+        } else {
+            addBytecodeInstruction(
+                new StringParameterInstruction(Opcode::LOAD, *ptr));
+        }
     }
     return *this;
 }
 
 BytecodeMethodBlock &BytecodeMethodBlock::store(const std::string &result) {
-    addBytecodeInstruction(
-        new StringParameterInstruction(Opcode::STORE, result));
+    if (slots == nullptr) {
+        addBytecodeInstruction(
+            new StringParameterInstruction(Opcode::STORE, result));
+    } else if (const auto *slot = find_slot(slots->locals, result)) {
+        addBytecodeInstruction(
+            new SlotInstruction(Opcode::STORE_LOCAL, *slot, result));
+    } else if (const auto *field = find_slot(slots->fields, result)) {
+        addBytecodeInstruction(
+            new SlotInstruction(Opcode::PUTFIELD, *field, result));
+    } else {
+        addBytecodeInstruction(
+            new StringParameterInstruction(Opcode::STORE, result));
+    }
     return *this;
 }
 
@@ -1,25 +1,43 @@
 #ifndef BYTECODE_METHOD_BLOCK_HPP
 #define BYTECODE_METHOD_BLOCK_HPP
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
 #include "bytecode/BytecodeInstruction.hpp"
 #include "util/serialize.hpp"
 
+using SlotMap = std::unordered_map<std::string, std::int64_t>;
+
+// Slot indices of every variable a method can name: its own variables, which
+// live in its frame, and the fields of its class.
+struct VariableSlots {
+    SlotMap locals;
+    SlotMap fields;
+};
+
 class BytecodeMethodBlock {
     std::vector<std::unique_ptr<BytecodeInstruction>> instructions;
     std::string name;
+    // Names found in neither slot map are emitted as name-based LOAD/STORE.
+    std::shared_ptr<const VariableSlots> slots;
+    // Source line given to the instructions added from now on.
+    int line = 0;
 
   public:
     bool operator==(const std::string &rhsName) { return name == rhsName; };
 
-    BytecodeMethodBlock(const std::string &name_) : name(name_) {};
+    BytecodeMethodBlock(const std::string &name_,
+                        std::shared_ptr<const VariableSlots> slots_ = nullptr)
+        : name(name_), slots(std::move(slots_)) {};
     [[nodiscard]] const std::string &getName() const { return name; }
     [[nodiscard]] const auto &getInstructions() const { return instructions; }
     void print(std::ostream &os) const;
+    void setLine(int line_) { line = line_; }
     void addBytecodeInstruction(BytecodeInstruction *instr);
 
     BytecodeMethodBlock &push(const std::variant<std::string, int> &operand);
@@ -4,17 +4,34 @@
 #include "util/serialize.hpp"
 
 #include <algorithm>
-#include <fstream>
 #include <iostream>
-#include <iterator>
+#include <sstream>
 #include <string>
 
+BytecodeClass &
+BytecodeProgram::addBytecodeClass(const std::string &name,
+                                  std::vector<std::string> fields,
+                                  std::vector<ValueKind> fieldKinds) {
+    const auto id = static_cast<std::int64_t>(classes.size());
+    return classes.emplace_back(name, id, std::move(fields),
+                                std::move(fieldKinds));
+}
+
+const BytecodeClass *
+BytecodeProgram::findBytecodeClass(const std::string &name) const {
+    const auto &it = std::find(classes.begin(), classes.end(), name);
+    return it != classes.end() ? &*it : nullptr;
+}
+
 BytecodeMethod &
 BytecodeProgram::addBytecodeMethod(const std::string &name,
                                    std::vector<std::string> variables,
-                                   std::vector<std::string> fieldVariables) {
-    methods.push_back(
-        BytecodeMethod(name, std::move(variables), std::move(fieldVariables)));
+                                   std::vector<ValueKind> variableKinds,
+                                   MethodSignature signature,
+                                   const BytecodeClass &owner) {
+    methods.push_back(BytecodeMethod(name, std::move(variables),
+                                     std::move(variableKinds),
+                                     std::move(signature), owner));
     return methods.back();
 }
 
@@ -41,21 +58,53 @@ BytecodeProgram::getInstructions() const {
 }
 
 void BytecodeProgram::print(std::ostream &os) const {
+    for (const auto &bytecodeClass : classes) {
+        bytecodeClass.print(os);
+    }
     for (const auto &method : methods) {
         method.print(os);
     }
 }
 
-void BytecodeProgram::serialize(std::ofstream &os) const {
-    Serializer serializer(os);
+void BytecodeProgram::serialize(std::ostream &os) const {
+    // The string table goes first but is only complete once everything
+    // else has been written, so the other sections are buffered.
+    StringTable strings;
+    std::ostringstream classSection;
+    Serializer classWriter(classSection, &strings);
+    classWriter.writeInteger(classes.size());
+    for (const auto &bytecodeClass : classes) {
+        bytecodeClass.serialize(classWriter);
+    }
 
-    const auto &mainMethod = methods.front();
-    mainMethod.serialize(serializer);
+    std::ostringstream directory;
+    std::ostringstream code;
+    Serializer directoryWriter(directory, &strings);
+    Serializer codeWriter(code, &strings);
+    directoryWriter.writeInteger(methods.size());
+    for (const auto &method : methods) {
+        const auto offset = static_cast<size_t>(code.tellp());
+        method.serialize(codeWriter);
+        directoryWriter.writeSymbol(method.getName());
+        method.serializeSignature(directoryWriter);
+        directoryWriter.writeInteger(offset);
+        directoryWriter.writeInteger(static_cast<size_t>(code.tellp()) -
+                                     offset);
+    }
 
-    serializer.writeInteger(methods.size() - 1);
+    std::ostringstream lineEntries;
+    Serializer lineWriter(lineEntries, &strings);
+    size_t linedMethods = 0;
+    for (const auto &method : methods) {
+        linedMethods += method.serializeLines(lineWriter) ? 1 : 0;
+    }
 
-    std::for_each(std::next(methods.cbegin()), methods.cend(),
-                  [&serializer](const BytecodeMethod &method) {
-                      method.serialize(serializer);
-                  });
+    Serializer serializer(os);
+    serializer.writeHeader();
+    serializer.writeStringVector(strings.getStrings());
+    os << classSection.view() << directory.view() << code.view();
+    if (linedMethods != 0) {
+        serializer.writeInteger(linedMethods);
+        os << lineEntries.view();
+    }
 }
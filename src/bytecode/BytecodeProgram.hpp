@@ -1,27 +1,53 @@
 #ifndef BYTECODE_HPP
 #define BYTECODE_HPP
 
+#include <ostream>
 #include <string>
 #include <vector>
 
+#include "bytecode/BytecodeClass.hpp"
 #include "bytecode/BytecodeMethod.hpp"
 
 class BytecodeProgram {
+    std::vector<BytecodeClass> classes;
     std::vector<BytecodeMethod> methods;
 
   public:
+    BytecodeClass &addBytecodeClass(const std::string &name,
+                                    std::vector<std::string> fields,
+                                    std::vector<ValueKind> fieldKinds);
+    [[nodiscard]] const BytecodeClass *
+    findBytecodeClass(const std::string &name) const;
+    [[nodiscard]] const auto &getClasses() const { return classes; }
+
     [[nodiscard]] BytecodeMethod &
     addBytecodeMethod(const std::string &name,
                       std::vector<std::string> variables,
-                      std::vector<std::string> fieldVariables);
+                      std::vector<ValueKind> variableKinds,
+                      MethodSignature signature, const BytecodeClass &owner);
 
     [[nodiscard]] BytecodeMethod &getBytecodeMethod(const std::string &name);
+    // In the order they were added; the first is the main method.
+    [[nodiscard]] const auto &getMethods() const { return methods; }
     [[nodiscard]] std::vector<const BytecodeInstruction *>
     getInstructions() const;
 
     void print(std::ostream &os) const;
 
-    void serialize(std::ofstream &os) const;
+    // Writes the program in the bytecode format the VM reads:
+    //   header         magic "MJBC" and format version
+    //   string table   every name the program uses, each stored once
+    //   classes        name, field names and field kinds of each class
+    //   directory      name, class, signature, code offset and code size
+    //                  of each method, the main method first
+    //   code           the method bodies, one after another, so a reader
+    //                  can decode each one only when it is needed
+    //   lines          optional: the source line of each instruction of
+    //                  each method that has them, by method name and
+    //                  run-length encoded; it follows the code, so readers
+    //                  that have no use for it never reach it
+    // Names are indices into the string table and every integer is LEB128.
+    void serialize(std::ostream &os) const;
 };
 
 #endif
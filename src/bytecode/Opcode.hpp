@@ -27,12 +27,19 @@ enum Opcode : int8_t {
     NEW_ARRAY = 20,
     ARRAY_LOAD = 21,
     ARRAY_STORE = 22,
-    ARRAY_LENGTH = 23
+    ARRAY_LENGTH = 23,
+    LOAD_LOCAL = 24,
+    STORE_LOCAL = 25,
+    GETFIELD = 26,
+    PUTFIELD = 27
 };
 
 const std::vector<std::string> mnemonics{
-    "ILOAD", "ICONST", "ISTORE",       "IADD",          "ISUB",    "IMUL",
-    "IDIV",  "ILT",    "IGT",          "IEQ",           "IAND",    "IOR",
-    "INOT",  "GOTO",   "IFFALSE GOTO", "INVOKEVIRTUAL", "IRETURN", "PRINT",
-    "STOP",  "NEW",    "NEWARRAY",     "IALOAD",        "IASTORE", "IALEN"};
+    "ILOAD",       "ICONST",       "ISTORE",       "IADD",
+    "ISUB",        "IMUL",         "IDIV",         "ILT",
+    "IGT",         "IEQ",          "IAND",         "IOR",
+    "INOT",        "GOTO",         "IFFALSE GOTO", "INVOKEVIRTUAL",
+    "IRETURN",     "PRINT",        "STOP",         "NEW",
+    "NEWARRAY",    "IALOAD",       "IASTORE",      "IALEN",
+    "ILOAD_LOCAL", "ISTORE_LOCAL", "GETFIELD",     "PUTFIELD"};
 #endif
@@ -0,0 +1,33 @@
+#ifndef VALUE_KIND_HPP
+#define VALUE_KIND_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What a VM value holds, as far as the garbage collector is concerned.
+// Object and array references are handles into separate heaps.
+enum class ValueKind : std::uint8_t {
+    Integer = 0,
+    Object = 1,
+    Array = 2,
+};
+
+[[nodiscard]] inline ValueKind value_kind_from_type(const std::string &type) {
+    if (type == "int" || type == "boolean") {
+        return ValueKind::Integer;
+    }
+    if (type == "int[]") {
+        return ValueKind::Array;
+    }
+    return ValueKind::Object;
+}
+
+// Parameter kinds in declaration order, without the receiver, and the kind of
+// the returned value.
+struct MethodSignature {
+    std::vector<ValueKind> parameters;
+    ValueKind result = ValueKind::Integer;
+};
+
+#endif
@@ -0,0 +1,299 @@
+#include "codegen/CMethodWriter.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <variant>
+
+namespace {
+// Integer arithmetic wraps around like the VM's, INT64_MIN / -1 included, and
+// every check reports the same error message as the VM (after "error: "
+// rather than the VM's prefix) before stopping the program.
+constexpr std::string_view runtime = R"(#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct mj_array {
+    int64_t length;
+    int64_t elements[];
+} mj_array;
+
+static void mj_fail(const char *message) {
+    fflush(stdout);
+    fprintf(stderr, "error: %s\n", message);
+    exit(EXIT_FAILURE);
+}
+
+static void *mj_allocate(size_t size) {
+    void *memory = calloc(1, size);
+    if (memory == NULL) {
+        mj_fail("out of memory");
+    }
+    return memory;
+}
+
+static inline void *mj_check_object(void *object) {
+    if (object == NULL) {
+        mj_fail("invalid object reference");
+    }
+    return object;
+}
+
+static inline mj_array *mj_check_array(mj_array *array) {
+    if (array == NULL) {
+        mj_fail("invalid array reference");
+    }
+    return array;
+}
+
+static inline int64_t mj_add(int64_t lhs, int64_t rhs) {
+    return (int64_t)((uint64_t)lhs + (uint64_t)rhs);
+}
+static inline int64_t mj_sub(int64_t lhs, int64_t rhs) {
+    return (int64_t)((uint64_t)lhs - (uint64_t)rhs);
+}
+static inline int64_t mj_mul(int64_t lhs, int64_t rhs) {
+    return (int64_t)((uint64_t)lhs * (uint64_t)rhs);
+}
+static inline int64_t mj_div(int64_t lhs, int64_t rhs) {
+    if (rhs == 0) {
+        mj_fail("division by zero");
+    }
+    return rhs == -1 ? mj_sub(0, lhs) : lhs / rhs;
+}
+static inline int64_t mj_less(int64_t lhs, int64_t rhs) { return lhs < rhs; }
+static inline int64_t mj_greater(int64_t lhs, int64_t rhs) {
+    return lhs > rhs;
+}
+static inline int64_t mj_equal(int64_t lhs, int64_t rhs) {
+    return lhs == rhs;
+}
+static inline int64_t mj_and(int64_t lhs, int64_t rhs) { return lhs && rhs; }
+static inline int64_t mj_or(int64_t lhs, int64_t rhs) { return lhs || rhs; }
+static inline int64_t mj_not(int64_t value) { return !value; }
+
+static inline mj_array *mj_new_array(int64_t length) {
+    if (length < 0) {
+        mj_fail("negative array length");
+    }
+    if ((uint64_t)length >
+        (SIZE_MAX - sizeof(mj_array)) / sizeof(int64_t)) {
+        mj_fail("out of memory");
+    }
+    mj_array *array =
+        mj_allocate(sizeof(mj_array) + (size_t)length * sizeof(int64_t));
+    array->length = length;
+    return array;
+}
+static inline int64_t mj_length(mj_array *array) {
+    return mj_check_array(array)->length;
+}
+static inline int64_t *mj_element(mj_array *array, int64_t index) {
+    if (index < 0 || index >= mj_check_array(array)->length) {
+        mj_fail("array index out of bounds");
+    }
+    return &array->elements[index];
+}
+static inline int64_t mj_load(mj_array *array, int64_t index) {
+    return *mj_element(array, index);
+}
+static inline void mj_store(mj_array *array, int64_t index, int64_t value) {
+    *mj_element(array, index) = value;
+}
+
+static inline void mj_print(int64_t value) {
+    printf("%" PRId64 "\n", value);
+}
+)";
+} // namespace
+
+void write_c_runtime(std::ostream &os) { os << runtime; }
+
+std::string c_class_name(const std::string &className) {
+    return "mj_class_" + className;
+}
+
+std::string c_method_name(const std::string &className,
+                          const std::string &methodName) {
+    // The length prefix keeps "A_b.c" and "A.b_c" apart.
+    return "mj_" + std::to_string(className.size()) + className + "_" +
+           methodName;
+}
+
+std::string c_variable_name(const std::string &name) { return "v_" + name; }
+
+std::string c_field_name(const std::string &name) { return "f_" + name; }
+
+std::string c_type(const std::string &type,
+                   const std::set<std::string> &classNames) {
+    if (type == "int" || type == "boolean") {
+        return "int64_t";
+    }
+    if (type == "int[]") {
+        return "mj_array *";
+    }
+    if (classNames.contains(type)) {
+        return "struct " + c_class_name(type) + " *";
+    }
+    return "void *";
+}
+
+std::string c_declaration(const std::string &type, const std::string &name) {
+    return type.ends_with('*') ? type + name : type + " " + name;
+}
+
+std::string CMethodWriter::value(const Operand &operand) const {
+    if (const auto *ptr = std::get_if<int>(&operand)) {
+        return "INT64_C(" + std::to_string(*ptr) + ")";
+    }
+    return variable(std::get<std::string>(operand));
+}
+
+std::string CMethodWriter::variable(const std::string &name) const {
+    if (name == "this") {
+        return "self";
+    }
+    if (!variables.locals.contains(name) && variables.fields.contains(name)) {
+        return "self->" + c_field_name(name);
+    }
+    return c_variable_name(name);
+}
+
+std::string CMethodWriter::typeOf(const Operand &operand) const {
+    const auto *name = std::get_if<std::string>(&operand);
+    if (name == nullptr) {
+        return "int64_t";
+    }
+    if (*name == "this") {
+        return selfType;
+    }
+    if (const auto it = variables.locals.find(*name);
+        it != variables.locals.end()) {
+        return it->second;
+    }
+    if (const auto it = variables.fields.find(*name);
+        it != variables.fields.end()) {
+        return it->second;
+    }
+    return "int64_t";
+}
+
+std::string CMethodWriter::labelName(const std::string &block) {
+    const auto [it, inserted] = labels.try_emplace(block, labels.size());
+    return "L" + std::to_string(it->second);
+}
+
+std::string CMethodWriter::apply(std::string_view function,
+                                 std::initializer_list<Operand> operands) {
+    std::string expression{function};
+    expression += "(";
+    for (auto it = operands.begin(); it != operands.end(); ++it) {
+        if (it != operands.begin()) {
+            expression += ", ";
+        }
+        expression += value(*it);
+    }
+    return expression + ")";
+}
+
+CMethodWriter &CMethodWriter::label(const std::string &block) {
+    definedLabels.insert(block);
+    // The empty statement keeps a label legal before a closing brace.
+    body << labelName(block) << ":;\n";
+    return *this;
+}
+
+CMethodWriter &CMethodWriter::statement(const std::string &code) {
+    body << "    " << code << ";\n";
+    return *this;
+}
+
+CMethodWriter &CMethodWriter::assign(const std::string &result,
+                                     const std::string &expression) {
+    return statement(variable(result) + " = " + expression);
+}
+
+CMethodWriter &CMethodWriter::new_object(const std::string &result,
+                                         const std::string &className) {
+    return assign(result, "mj_allocate(sizeof(struct " +
+                              c_class_name(className) + "))");
+}
+
+CMethodWriter &CMethodWriter::param(const Operand &operand) {
+    // Arguments are copied when the bytecode would push them, so later
+    // arguments cannot change the value of earlier ones.
+    const auto name = "a" + std::to_string(argumentDeclarations.size());
+    argumentDeclarations.push_back(c_declaration(typeOf(operand), name));
+    pendingArguments.push_back(name);
+    return statement(name + " = " + value(operand));
+}
+
+CMethodWriter &CMethodWriter::call(const std::string &result,
+                                   const Operand &receiver,
+                                   const std::string &method,
+                                   std::size_t argumentCount) {
+    const auto dot = method.find('.');
+    if (dot == std::string::npos || argumentCount > pendingArguments.size()) {
+        throw std::runtime_error("invalid call to " + method);
+    }
+    auto expression =
+        c_method_name(method.substr(0, dot), method.substr(dot + 1)) +
+        "(mj_check_object(" + value(receiver) + ")";
+    const auto first = pendingArguments.end() -
+                       static_cast<std::ptrdiff_t>(argumentCount);
+    for (auto it = first; it != pendingArguments.end(); ++it) {
+        expression += ", " + *it;
+    }
+    pendingArguments.erase(first, pendingArguments.end());
+    return assign(result, expression + ")");
+}
+
+CMethodWriter &CMethodWriter::ret(const Operand &operand) {
+    return statement("return " + value(operand));
+}
+
+CMethodWriter &CMethodWriter::jump(const std::string &block) {
+    return statement("goto " + labelName(block));
+}
+
+CMethodWriter &CMethodWriter::cjump(const Operand &condition,
+                                    const std::string &block) {
+    body << "    if (!" << value(condition) << ") {\n";
+    body << "        goto " << labelName(block) << ";\n";
+    body << "    }\n";
+    return *this;
+}
+
+CMethodWriter &CMethodWriter::stop() { return statement("return 0"); }
+
+void CMethodWriter::write(std::ostream &os,
+                          const std::string &signature) const {
+    os << signature << " {\n";
+    for (const auto &[name, type] : variables.locals) {
+        if (name != "this" && !parameters.contains(name)) {
+            os << "    " << c_declaration(type, c_variable_name(name))
+               << " = 0;\n";
+        }
+    }
+    for (const auto &declaration : argumentDeclarations) {
+        os << "    " << declaration << ";\n";
+    }
+    os << body.str();
+    // A jump to a block that was never generated fails when it is taken,
+    // as it does in the VM.
+    std::vector<std::pair<std::size_t, std::string>> missing;
+    for (const auto &[block, index] : labels) {
+        if (!definedLabels.contains(block)) {
+            missing.emplace_back(index, block);
+        }
+    }
+    std::ranges::sort(missing);
+    for (const auto &[index, block] : missing) {
+        os << "L" << index << ":;\n";
+        os << "    mj_fail(\"block " << block << " not found\");\n";
+        os << "    return 0;\n";
+    }
+    os << "}\n";
+}
@@ -0,0 +1,94 @@
+#ifndef C_METHOD_WRITER_HPP
+#define C_METHOD_WRITER_HPP
+
+#include <cstddef>
+#include <initializer_list>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ir/Tac.hpp"
+
+// C declarations the translated program relies on: value representation,
+// checked arrays and the arithmetic and error helpers every method calls.
+void write_c_runtime(std::ostream &os);
+
+// Mangled C names. Every MiniJava name gets a fixed prefix, so translated
+// names never collide with C keywords or with the runtime.
+[[nodiscard]] std::string c_class_name(const std::string &className);
+[[nodiscard]] std::string c_method_name(const std::string &className,
+                                        const std::string &methodName);
+[[nodiscard]] std::string c_variable_name(const std::string &name);
+[[nodiscard]] std::string c_field_name(const std::string &name);
+// C type of a MiniJava type; classNames lists the types that are classes.
+[[nodiscard]] std::string c_type(const std::string &type,
+                                 const std::set<std::string> &classNames);
+// Declaration of name with the given C type, such as "mj_array *v_a".
+[[nodiscard]] std::string c_declaration(const std::string &type,
+                                        const std::string &name);
+
+// C types of every variable a method can name: its own variables, which
+// become C locals, and the fields of its class, reached through self.
+struct CVariableTypes {
+    std::map<std::string, std::string> locals;
+    std::map<std::string, std::string> fields;
+};
+
+// Collects the body of one C function while the method's blocks are
+// translated, in the same order as their bytecode, so that blocks falling
+// through to the next one behave the same.
+class CMethodWriter {
+    std::string selfType;
+    CVariableTypes variables;
+    std::set<std::string> parameters;
+    std::ostringstream body;
+    std::unordered_map<std::string, std::size_t> labels;
+    std::set<std::string> definedLabels;
+    // Declarations of the temporaries holding call arguments, and the
+    // arguments not yet passed to a call.
+    std::vector<std::string> argumentDeclarations;
+    std::vector<std::string> pendingArguments;
+
+    [[nodiscard]] std::string typeOf(const Operand &operand) const;
+    [[nodiscard]] std::string labelName(const std::string &block);
+
+  public:
+    CMethodWriter(std::string selfType_, CVariableTypes variables_,
+                  std::set<std::string> parameters_)
+        : selfType(std::move(selfType_)), variables(std::move(variables_)),
+          parameters(std::move(parameters_)) {};
+
+    [[nodiscard]] std::string value(const Operand &operand) const;
+    [[nodiscard]] std::string variable(const std::string &name) const;
+    // A call of the runtime function with the given operands.
+    [[nodiscard]] std::string apply(std::string_view function,
+                                    std::initializer_list<Operand> operands);
+
+    CMethodWriter &label(const std::string &block);
+    CMethodWriter &statement(const std::string &code);
+    CMethodWriter &assign(const std::string &result,
+                          const std::string &expression);
+    CMethodWriter &new_object(const std::string &result,
+                              const std::string &className);
+
+    CMethodWriter &param(const Operand &operand);
+    CMethodWriter &call(const std::string &result, const Operand &receiver,
+                        const std::string &method, std::size_t argumentCount);
+    CMethodWriter &ret(const Operand &operand);
+
+    CMethodWriter &jump(const std::string &block);
+    CMethodWriter &cjump(const Operand &condition, const std::string &block);
+
+    CMethodWriter &stop();
+
+    // Writes the function definition, declaring every local the body uses.
+    void write(std::ostream &os, const std::string &signature) const;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#include "codegen/NativeCompiler.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <sstream>
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+std::vector<std::string> nativeCompilerCommand() {
+    std::vector<std::string> command;
+    if (const char *cc = std::getenv("CC"); cc != nullptr) {
+        std::istringstream words(cc);
+        for (std::string word; words >> word;) {
+            command.push_back(std::move(word));
+        }
+    }
+    if (command.empty()) {
+        command.emplace_back("cc");
+    }
+    return command;
+}
+
+bool compileNative(const std::filesystem::path &cPath,
+                   const std::filesystem::path &executable) {
+    auto command = nativeCompilerCommand();
+    command.insert(command.end(),
+                   {"-O2", "-o", executable.string(), cPath.string()});
+    std::vector<char *> argv;
+    argv.reserve(command.size() + 1);
+    for (auto &arg : command) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = 0;
+    if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) !=
+        0) {
+        return false;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
@@ -0,0 +1,19 @@
+#ifndef NATIVE_COMPILER_HPP
+#define NATIVE_COMPILER_HPP
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// The command that builds C into an executable: $CC split into words when
+// it is set, like make does, otherwise cc.
+[[nodiscard]] std::vector<std::string> nativeCompilerCommand();
+
+// Builds cPath into executable with the system C compiler at -O2. The
+// compiler is started directly rather than through a shell, so paths are
+// passed as they are whatever characters they contain. Returns whether it
+// ran and succeeded.
+bool compileNative(const std::filesystem::path &cPath,
+                   const std::filesystem::path &executable);
+
+#endif
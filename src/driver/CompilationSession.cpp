@@ -0,0 +1,166 @@
+#include "driver/CompilationSession.hpp"
+
+#include <sstream>
+#include <utility>
+
+#include "ir/IRGenerationVisitor.hpp"
+#include "ir/passes/ConditionalJumpFoldingPass.hpp"
+#include "ir/passes/ConstantFoldingPass.hpp"
+#include "ir/passes/IRPassManager.hpp"
+#include "lexing/Lexer.hpp"
+#include "lexing/StringViewStream.hpp"
+#include "parsing/Parser.hpp"
+#include "semantic/SymbolTableVisitor.hpp"
+
+namespace {
+
+// Appends diagnostics to a session's list and counts the errors among them.
+// Once the lexer has reported an error, the syntax errors that follow from it
+// are dropped.
+class CollectingDiagnosticSink final : public lexing::DiagnosticSink {
+  public:
+    explicit CollectingDiagnosticSink(
+        std::vector<lexing::Diagnostic> &diagnostics_,
+        const CollectingDiagnosticSink *gate_ = nullptr)
+        : diagnostics(diagnostics_), gate(gate_) {}
+
+    void emit(lexing::Diagnostic d) override {
+        if (gate != nullptr && gate->errorCount != 0) {
+            return;
+        }
+        if (d.severity == lexing::Severity::Error) {
+            errorCount += 1;
+        }
+        diagnostics.push_back(std::move(d));
+    }
+
+    [[nodiscard]] int getErrorCount() const { return errorCount; }
+
+  private:
+    std::vector<lexing::Diagnostic> &diagnostics;
+    const CollectingDiagnosticSink *gate;
+    int errorCount = 0;
+};
+
+} // namespace
+
+int exitCode(CompileStatus status) {
+    switch (status) {
+    case CompileStatus::Success:
+        return 0;
+    case CompileStatus::LexicalError:
+        return 1;
+    case CompileStatus::SyntaxError:
+        return 2;
+    case CompileStatus::SymbolTableError:
+    case CompileStatus::TypeError:
+    case CompileStatus::IRError:
+        return 4;
+    }
+    return 4;
+}
+
+CompilationSession::CompilationSession(lexing::SourceBuffer source_)
+    : source(std::move(source_)) {}
+
+CompilationSession::CompilationSession(std::string source_)
+    : source(lexing::SourceBuffer::from_string(std::move(source_))) {}
+
+CompileStatus CompilationSession::compile(TimeReport *report) {
+    if (compiled) {
+        return status;
+    }
+    compiled = true;
+
+    CollectingDiagnosticSink lexDiagnostics(diagnostics);
+    CollectingDiagnosticSink syntaxDiagnostics(diagnostics, &lexDiagnostics);
+    {
+        const TimeReport::Scope timer(report, "parse");
+        auto stream =
+            std::make_unique<lexing::StringViewStream>(source.view());
+        lexing::Lexer lexer(std::move(stream), source.view(), &lexDiagnostics);
+        parsing::Parser parser(std::move(lexer), &syntaxDiagnostics);
+        PhaseAccumulator lexing;
+        if (report != nullptr) {
+            parser.time_lexing(&lexing);
+        }
+
+        auto parseResult = parser.parse_goal();
+        if (report != nullptr) {
+            report->add("lex", lexing);
+        }
+        if (!parseResult.has_value()) {
+            return status = CompileStatus::SyntaxError;
+        }
+        root = std::move(parseResult.value());
+    }
+    if (lexDiagnostics.getErrorCount() != 0) {
+        return status = CompileStatus::LexicalError;
+    }
+
+    CollectingDiagnosticSink semanticDiagnostics(diagnostics);
+    {
+        const TimeReport::Scope timer(report, "build_symbol_table");
+        if (!build_symbol_table(*root, symbolTable, &semanticDiagnostics)
+                 .ok()) {
+            return status = CompileStatus::SymbolTableError;
+        }
+    }
+    {
+        const TimeReport::Scope timer(report, "check_types");
+        if (!check_types(*root, symbolTable, &typeInfo, &semanticDiagnostics)
+                 .ok()) {
+            return status = CompileStatus::TypeError;
+        }
+    }
+
+    graph.setTypeInfo(&typeInfo);
+    {
+        const TimeReport::Scope timer(report, "generate_ir");
+        if (!generate_ir(*root, graph, symbolTable, &semanticDiagnostics)
+                 .ok()) {
+            return status = CompileStatus::IRError;
+        }
+    }
+
+    {
+        const TimeReport::Scope timer(report, "ir_passes");
+        IRPassManager passManager;
+        passManager.addPass(std::make_unique<ConstantFoldingPass>());
+        passManager.addPass(std::make_unique<ConditionalJumpFoldingPass>());
+        (void)passManager.run(graph, report);
+    }
+
+    const TimeReport::Scope timer(report, "generate_bytecode");
+    graph.generateBytecode(program, symbolTable);
+    return status = CompileStatus::Success;
+}
+
+void CompilationSession::report(std::ostream &out, std::ostream &err) const {
+    for (const auto &diagnostic : diagnostics) {
+        err << diagnostic.message;
+    }
+    switch (status) {
+    case CompileStatus::SymbolTableError:
+        out << "Symbol table construction failed.\n";
+        break;
+    case CompileStatus::TypeError:
+        out << "Type checking failed.\n";
+        break;
+    case CompileStatus::IRError:
+        out << "IR generation failed.\n";
+        break;
+    default:
+        break;
+    }
+}
+
+std::string CompilationSession::serialize() const {
+    std::ostringstream os;
+    program.serialize(os);
+    return std::move(os).str();
+}
+
+void CompilationSession::generateC(std::ostream &os) {
+    graph.generateC(os, symbolTable);
+}
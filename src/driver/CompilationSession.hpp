@@ -0,0 +1,91 @@
+#ifndef COMPILATION_SESSION_HPP
+#define COMPILATION_SESSION_HPP
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ast/Node.h"
+#include "bytecode/BytecodeProgram.hpp"
+#include "ir/CFG.hpp"
+#include "lexing/Diagnostics.hpp"
+#include "lexing/SourceBuffer.hpp"
+#include "semantic/SymbolTable.hpp"
+#include "semantic/TypeCheckVisitor.hpp"
+#include "util/TimeReport.hpp"
+
+// How far a compilation got: the phase that failed, or Success.
+enum class CompileStatus {
+    Success,
+    LexicalError,
+    SyntaxError,
+    SymbolTableError,
+    TypeError,
+    IRError
+};
+
+// The compiler's exit code for a status: 0 on success, 1 for lexical, 2 for
+// syntax and 4 for semantic errors.
+int exitCode(CompileStatus status);
+
+// The state of one compilation: its source, syntax tree, symbol table,
+// control flow graph and bytecode. Diagnostics are collected rather than
+// printed, in the order they were reported. Sessions share nothing, so
+// separate sessions can compile on separate threads; a single session is
+// not safe to use from more than one thread at a time.
+class CompilationSession {
+  private:
+    lexing::SourceBuffer source;
+    std::vector<lexing::Diagnostic> diagnostics;
+    std::unique_ptr<Node> root;
+    SymbolTable symbolTable;
+    TypeInfo typeInfo;
+    CFG graph;
+    BytecodeProgram program;
+    CompileStatus status = CompileStatus::Success;
+    bool compiled = false;
+
+  public:
+    explicit CompilationSession(lexing::SourceBuffer source_);
+    explicit CompilationSession(std::string source_);
+    // The graph refers to the session's type information.
+    CompilationSession(const CompilationSession &) = delete;
+    CompilationSession &operator=(const CompilationSession &) = delete;
+
+    // Runs every phase up to bytecode generation, stopping at the first
+    // that fails, and times them in report if one is given. Later calls
+    // return the first call's status.
+    CompileStatus compile(TimeReport *report = nullptr);
+
+    [[nodiscard]] CompileStatus getStatus() const { return status; }
+    [[nodiscard]] bool succeeded() const {
+        return compiled && status == CompileStatus::Success;
+    }
+    [[nodiscard]] const lexing::SourceBuffer &getSource() const {
+        return source;
+    }
+    [[nodiscard]] const std::vector<lexing::Diagnostic> &
+    getDiagnostics() const {
+        return diagnostics;
+    }
+    // Null until the source has parsed.
+    [[nodiscard]] Node *getRoot() const { return root.get(); }
+    [[nodiscard]] const SymbolTable &getSymbolTable() const {
+        return symbolTable;
+    }
+    [[nodiscard]] const CFG &getGraph() const { return graph; }
+    // Empty unless compile() succeeded.
+    [[nodiscard]] const BytecodeProgram &getProgram() const { return program; }
+
+    // Prints what the compiler reports for this compilation: the diagnostics
+    // to err and the phase that failed, if any, to out.
+    void report(std::ostream &out, std::ostream &err) const;
+
+    // The program in the format written to prog.bc.
+    [[nodiscard]] std::string serialize() const;
+    // Translates the compiled program into a single C file.
+    void generateC(std::ostream &os);
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include "driver/Server.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "driver/CompilationSession.hpp"
+
+#if __has_include(<sys/socket.h>) && __has_include(<sys/un.h>)
+#define MINIJAVA_SERVE 1
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#else
+#define MINIJAVA_SERVE 0
+#endif
+
+#if MINIJAVA_SERVE
+namespace {
+
+constexpr size_t maxHeaderLength = 64;
+constexpr size_t maxSourceLength = size_t{1} << 30;
+
+// Buffered reads from a file descriptor.
+class Reader {
+    int fd;
+    std::array<char, 1 << 16> buffer{};
+    size_t position = 0;
+    size_t end = 0;
+
+    bool fill() {
+        position = 0;
+        end = 0;
+        while (true) {
+            const auto count = ::read(fd, buffer.data(), buffer.size());
+            if (count >= 0 || errno != EINTR) {
+                end = count > 0 ? static_cast<size_t>(count) : 0;
+                return end != 0;
+            }
+        }
+    }
+
+  public:
+    explicit Reader(int fd_) : fd(fd_) {}
+
+    // Reads up to a newline, which is dropped. Fails at the end of the input
+    // or if the line is longer than maxLength.
+    bool readLine(std::string &line, size_t maxLength) {
+        line.clear();
+        while (true) {
+            if (position == end && !fill()) {
+                return false;
+            }
+            const auto *start = buffer.data() + position;
+            const auto *stop = buffer.data() + end;
+            const auto *newline = std::find(start, stop, '\n');
+            line.append(start, newline);
+            position = static_cast<size_t>(newline - buffer.data());
+            if (line.size() > maxLength) {
+                return false;
+            }
+            if (newline != stop) {
+                position += 1;
+                return true;
+            }
+        }
+    }
+
+    bool readExactly(std::string &bytes, size_t length) {
+        bytes.clear();
+        while (bytes.size() < length) {
+            if (position == end && !fill()) {
+                return false;
+            }
+            const auto count = std::min(length - bytes.size(), end - position);
+            bytes.append(buffer.data() + position, count);
+            position += count;
+        }
+        return true;
+    }
+};
+
+bool writeAll(int fd, std::string_view bytes) {
+    while (!bytes.empty()) {
+        const auto count = ::write(fd, bytes.data(), bytes.size());
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes.remove_prefix(static_cast<size_t>(count));
+    }
+    return true;
+}
+
+bool respond(int fd, std::string &response, int exitCode,
+             std::string_view out, std::string_view err,
+             std::string_view bytecode) {
+    response.clear();
+    response += std::to_string(exitCode);
+    for (const auto length : {out.size(), err.size(), bytecode.size()}) {
+        response += ' ';
+        response += std::to_string(length);
+    }
+    response += '\n';
+    response += out;
+    response += err;
+    response += bytecode;
+    return writeAll(fd, response);
+}
+
+// Splits "<command> <length>" into its parts.
+bool parseHeader(std::string_view header, std::string_view &command,
+                 size_t &length) {
+    const auto space = header.find(' ');
+    if (space == std::string_view::npos) {
+        return false;
+    }
+    command = header.substr(0, space);
+    const auto digits = header.substr(space + 1);
+    const auto [end, ec] =
+        std::from_chars(digits.data(), digits.data() + digits.size(), length);
+    return !digits.empty() && ec == std::errc() &&
+           end == digits.data() + digits.size() && length <= maxSourceLength;
+}
+
+} // namespace
+
+bool serveConnection(int inFd, int outFd, const VmOptions &options) {
+    Reader reader(inFd);
+    // Kept across requests so that later ones reuse their capacity.
+    std::string header;
+    std::string source;
+    std::string response;
+
+    while (true) {
+        if (!reader.readLine(header, maxHeaderLength)) {
+            // The input may only end between requests.
+            if (header.empty()) {
+                return true;
+            }
+            (void)respond(outFd, response, 1, {},
+                          "Error: Malformed request.\n", {});
+            return false;
+        }
+        std::string_view command;
+        size_t length = 0;
+        if (!parseHeader(header, command, length) ||
+            (command != "compile" && command != "run")) {
+            (void)respond(outFd, response, 1, {},
+                          "Error: Malformed request.\n", {});
+            return false;
+        }
+        if (!reader.readExactly(source, length)) {
+            return false;
+        }
+
+        CompilationSession session(
+            lexing::SourceBuffer::from_string(source));
+        const auto status = session.compile();
+        std::ostringstream out;
+        std::ostringstream err;
+        session.report(out, err);
+        int code = exitCode(status);
+        std::string bytecode;
+        if (status == CompileStatus::Success) {
+            if (command == "run") {
+                if (!runBytecodeProgram(session.getProgram(), options, out,
+                                        err)) {
+                    code = 1;
+                }
+            } else {
+                bytecode = session.serialize();
+            }
+        }
+        if (!respond(outFd, response, code, out.view(), err.view(),
+                     bytecode)) {
+            return false;
+        }
+    }
+}
+
+bool serveSocket(const std::string &path, const VmOptions &options) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path " << path << " is too long.\n";
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // Replace a socket left behind by an earlier server, but nothing else.
+    struct stat existing {};
+    if (::lstat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        ::unlink(path.c_str());
+    }
+
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 ||
+        ::bind(listener, reinterpret_cast<const sockaddr *>(&address),
+               sizeof(address)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "Error: Unable to listen on " << path << ": "
+                  << std::strerror(errno) << ".\n";
+        if (listener >= 0) {
+            ::close(listener);
+        }
+        return false;
+    }
+    // A client that goes away mid-response must not end the server.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    while (true) {
+        const int connection = ::accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            std::cerr << "Error: Unable to accept a connection on " << path
+                      << ": " << std::strerror(errno) << ".\n";
+            ::close(listener);
+            return false;
+        }
+        (void)serveConnection(connection, connection, options);
+        ::close(connection);
+    }
+}
+#else
+bool serveConnection(int, int, const VmOptions &) {
+    std::cerr << "Error: --serve is not supported on this platform.\n";
+    return false;
+}
+
+bool serveSocket(const std::string &, const VmOptions &) {
+    std::cerr << "Error: --serve is not supported on this platform.\n";
+    return false;
+}
+#endif
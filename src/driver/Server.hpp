@@ -0,0 +1,34 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <string>
+
+#include "vm/Interpreter.hpp"
+
+// The protocol spoken by `compiler --serve`. A client sends any number of
+// requests, each a header line followed by the MiniJava source:
+//
+//   compile <length>\n<length bytes of source>
+//   run <length>\n<length bytes of source>
+//
+// and gets one response per request, in order:
+//
+//   <exit code> <stdout length> <stderr length> <bytecode length>\n
+//   <stdout><stderr><bytecode>
+//
+// The exit code, stdout and stderr are what `compiler` would have produced
+// for the file, and for run what `compiler --run` would have. Bytecode is
+// the contents of prog.bc after a successful compile and empty otherwise.
+// Lengths are decimal byte counts. A malformed request gets a response with
+// exit code 1, after which the server closes the connection.
+
+// Answers requests read from inFd on outFd until the input ends. Returns
+// false if it ended in the middle of a request, on a malformed request or
+// when a response could not be written.
+bool serveConnection(int inFd, int outFd, const VmOptions &options);
+
+// Listens on a Unix domain socket at path and serves one connection at a time
+// until an error stops it, which it reports before returning.
+bool serveSocket(const std::string &path, const VmOptions &options);
+
+#endif
@@ -1,5 +1,7 @@
 #include "ir/ArithmeticTac.hpp"
 
+#include "codegen/CMethodWriter.hpp"
+
 void AddTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(lhsOp).push(rhsOp).add().store(result);
 }
@@ -12,3 +14,15 @@ void MultiplyTac::generateBytecode(BytecodeMethodBlock &block) {
 void DivideTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(lhsOp).push(rhsOp).divide().store(result);
 }
+void AddTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_add", {lhsOp, rhsOp}));
+}
+void SubtractTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_sub", {lhsOp, rhsOp}));
+}
+void MultiplyTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_mul", {lhsOp, rhsOp}));
+}
+void DivideTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_div", {lhsOp, rhsOp}));
+}
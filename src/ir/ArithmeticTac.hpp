@@ -8,6 +8,7 @@ class AddTac : public Tac {
     AddTac(const std::string &result_, const Operand &y_, const Operand &z_)
         : Tac(result_, y_, "+", z_) {};
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class SubtractTac : public Tac {
@@ -16,6 +17,7 @@ class SubtractTac : public Tac {
                 const Operand &z_)
         : Tac(result_, y_, "-", z_) {};
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class MultiplyTac : public Tac {
@@ -24,6 +26,7 @@ class MultiplyTac : public Tac {
                 const Operand &z_)
         : Tac(result_, y_, "*", z_) {};
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class DivideTac : public Tac {
@@ -31,6 +34,7 @@ class DivideTac : public Tac {
     DivideTac(const std::string &result_, const Operand &y_, const Operand &z_)
         : Tac(result_, y_, "/", z_) {};
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 #endif
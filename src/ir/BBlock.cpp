@@ -35,6 +35,7 @@ void BBlock::generateBytecode(BytecodeMethod &method) {
     auto &methodBlock = method.getBytecodeMethodBlock(name);
 
     for (const auto &instruction : instructions) {
+        methodBlock.setLine(instruction->getLine());
         instruction->generateBytecode(methodBlock);
     }
 
@@ -51,3 +52,25 @@ void BBlock::generateBytecode(BytecodeMethod &method) {
         }
     }
 }
+
+// Mirrors generateBytecode, so blocks are laid out in the same order. Leaf
+// blocks end the function, which only matters for the main method: the
+// others already end in a return.
+void BBlock::generateC(CMethodWriter &writer) {
+    markGenerated();
+
+    writer.label(name);
+    for (const auto &instruction : instructions) {
+        instruction->generateC(writer);
+    }
+    if (!hasTrueBlock() && !hasFalseBlock()) {
+        writer.stop();
+    }
+
+    if (hasTrueBlock() && !trueExit->isGenerated()) {
+        trueExit->generateC(writer);
+    }
+    if (hasTrueBlock() && hasFalseBlock() && !falseExit->isGenerated()) {
+        falseExit->generateC(writer);
+    }
+}
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "bytecode/BytecodeMethod.hpp"
+#include "codegen/CMethodWriter.hpp"
 #include "ir/Tac.hpp"
 
 class BBlock {
@@ -16,6 +17,8 @@ class BBlock {
     BBlock *falseExit = nullptr;
     bool visited = false;
     bool generated = false;
+    // For a method's entry block, the line the method is declared on.
+    int line = 0;
 
   public:
     BBlock(const std::string &className_, const std::string &methodName_)
@@ -26,6 +29,8 @@ class BBlock {
     [[nodiscard]] const auto &getName() const { return name; }
     [[nodiscard]] const auto &getClassName() const { return className; }
     [[nodiscard]] const auto &getMethodName() const { return methodName; }
+    [[nodiscard]] int getLine() const { return line; }
+    void setLine(int line_) { line = line_; }
 
     void setTrueBlock(BBlock *ptr) { trueExit = ptr; }
     void setFalseBlock(BBlock *ptr) { falseExit = ptr; }
@@ -51,6 +56,7 @@ class BBlock {
     void resetGenerated() { generated = false; };
 
     void generateBytecode(BytecodeMethod &method);
+    void generateC(CMethodWriter &writer);
 };
 
 #endif
@@ -1,5 +1,7 @@
 #include "ir/BooleanTac.hpp"
 
+#include "codegen/CMethodWriter.hpp"
+
 void AndTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(lhsOp).push(rhsOp).l_and().store(result);
 }
@@ -7,3 +9,11 @@ void AndTac::generateBytecode(BytecodeMethodBlock &block) {
 void OrTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(lhsOp).push(rhsOp).l_or().store(result);
 }
+
+void AndTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_and", {lhsOp, rhsOp}));
+}
+
+void OrTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_or", {lhsOp, rhsOp}));
+}
@@ -8,6 +8,7 @@ class AndTac : public Tac {
     AndTac(const std::string &result_, const Operand &y_, const Operand &z_)
         : Tac(result_, y_, "&&", z_) {};
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class OrTac : public Tac {
@@ -15,6 +16,7 @@ class OrTac : public Tac {
     OrTac(const std::string &result_, const Operand &y_, const Operand &z_)
         : Tac(result_, y_, "||", z_) {};
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 #endif
@@ -1,6 +1,8 @@
 #include <algorithm>
 #include <iostream>
 #include <set>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -88,7 +90,10 @@ BBlock *CFG::newBlock() {
     return ownBlock(std::make_unique<BBlock>(getBlockName()));
 }
 
-void CFG::addInstruction(Tac *ptr) { currentBlock->addInstruction(ptr); }
+void CFG::addInstruction(Tac *ptr) {
+    ptr->setLine(currentLine);
+    currentBlock->addInstruction(ptr);
+}
 
 BBlock *CFG::addMethodBlock() {
     auto *ptr = ownBlock(std::make_unique<BBlock>(getBlockName()));
@@ -99,6 +104,7 @@ BBlock *CFG::addMethodBlock() {
 BBlock *CFG::addMethodRootBlock(const std::string &className,
                                 const std::string &methodName) {
     auto *ptr = ownBlock(std::make_unique<BBlock>(className, methodName));
+    ptr->setLine(currentLine);
     methodRoots.push_back(ptr);
     return ptr;
 }
@@ -114,6 +120,21 @@ void CFG::generateBytecode(BytecodeProgram &program, SymbolTable &st) {
     resetGeneratedFlags();
     BBlock *mainRoot = nullptr;
 
+    for (const auto &className : st.getClassNames()) {
+        auto *classScope = st.resolveClassScope(className);
+        std::vector<std::string> fields;
+        std::vector<ValueKind> fieldKinds;
+        for (const auto &field : classScope->getVariableNames()) {
+            if (field != "this") {
+                fields.push_back(field);
+                fieldKinds.push_back(value_kind_from_type(
+                    classScope->lookupVariableInScope(field)->getType()));
+            }
+        }
+        program.addBytecodeClass(className, std::move(fields),
+                                 std::move(fieldKinds));
+    }
+
     for (auto *basicBlock : methodRoots) {
         if (mainRoot == nullptr) {
             mainRoot = basicBlock;
@@ -124,22 +145,38 @@ void CFG::generateBytecode(BytecodeProgram &program, SymbolTable &st) {
 
         auto *methodScope = st.resolveScope(className, methodName);
         const auto *method = dynamic_cast<Method *>(methodScope->getRecord());
-        const auto *classScope = methodScope->getParent();
+        const auto *owner = program.findBytecodeClass(className);
+        if (owner == nullptr) {
+            throw std::runtime_error("no class layout for " + className);
+        }
 
         const auto methodParameters = method->getParameterNames();
         const auto &blockName = basicBlock->getName();
-        const auto variableNames = methodScope->getVariableNames();
-        auto fieldVariableNames = classScope != nullptr
-                                      ? classScope->getVariableNames()
-                                      : std::set<std::string>{};
-
-        std::vector<std::string> variables(variableNames.begin(),
-                                           variableNames.end());
-        std::vector<std::string> fieldVariables(fieldVariableNames.begin(),
-                                                fieldVariableNames.end());
+
+        // Slot 0 always holds the receiver so field accesses can find it
+        // without a name lookup.
+        std::vector<std::string> variables{"this"};
+        std::vector<ValueKind> variableKinds{ValueKind::Object};
+        for (const auto &variable : methodScope->getVariableNames()) {
+            if (variable != "this") {
+                variables.push_back(variable);
+                variableKinds.push_back(value_kind_from_type(
+                    methodScope->lookupVariableInScope(variable)->getType()));
+            }
+        }
+        MethodSignature signature{.parameters = {},
+                                  .result = value_kind_from_type(
+                                      method->getType())};
+        for (const auto *parameter : method->getParameters()) {
+            signature.parameters.push_back(
+                value_kind_from_type(parameter->getType()));
+        }
         auto &bytecodeMethod = program.addBytecodeMethod(
-            blockName, std::move(variables), std::move(fieldVariables));
+            blockName, std::move(variables), std::move(variableKinds),
+            std::move(signature), *owner);
         auto &bytecodeBlock = bytecodeMethod.addBytecodeMethodBlock(blockName);
+        // Taking the arguments off the stack counts towards the declaration.
+        bytecodeBlock.setLine(basicBlock->getLine());
 
         if (basicBlock != mainRoot) {
             bytecodeBlock.store("this");
@@ -158,3 +195,100 @@ void CFG::generateBytecode(BytecodeProgram &program, SymbolTable &st) {
         appendStopToLeafBlocks(mainRoot, mainMethod);
     }
 }
+
+void CFG::generateC(std::ostream &os, SymbolTable &st) {
+    resetGeneratedFlags();
+    const auto classNames = st.getClassNames();
+
+    write_c_runtime(os);
+    os << "\n";
+    for (const auto &className : classNames) {
+        os << "struct " << c_class_name(className) << ";\n";
+    }
+    for (const auto &className : classNames) {
+        auto *classScope = st.resolveClassScope(className);
+        os << "\nstruct " << c_class_name(className) << " {\n";
+        // C does not allow empty structs.
+        os << "    char unused;\n";
+        for (const auto &field : classScope->getVariableNames()) {
+            if (field != "this") {
+                const auto type = c_type(
+                    classScope->lookupVariableInScope(field)->getType(),
+                    classNames);
+                os << "    " << c_declaration(type, c_field_name(field))
+                   << ";\n";
+            }
+        }
+        os << "};\n";
+    }
+
+    std::ostringstream definitions;
+    BBlock *mainRoot = nullptr;
+    os << "\n";
+    for (auto *basicBlock : methodRoots) {
+        if (mainRoot == nullptr) {
+            mainRoot = basicBlock;
+        }
+
+        const auto &className = basicBlock->getClassName();
+        const auto &methodName = basicBlock->getMethodName();
+        auto *methodScope = st.resolveScope(className, methodName);
+        const auto *method = dynamic_cast<Method *>(methodScope->getRecord());
+        const auto selfType = c_type(className, classNames);
+
+        CVariableTypes variables;
+        for (const auto &variable : methodScope->getVariableNames()) {
+            variables.locals.emplace(
+                variable,
+                c_type(methodScope->lookupVariableInScope(variable)->getType(),
+                       classNames));
+        }
+        auto *classScope = st.resolveClassScope(className);
+        for (const auto &field : classScope->getVariableNames()) {
+            if (field != "this") {
+                variables.fields.emplace(
+                    field,
+                    c_type(classScope->lookupVariableInScope(field)->getType(),
+                           classNames));
+            }
+        }
+
+        // Every function returns a value so that a leaf block can always end
+        // in "return 0"; main's result is ignored.
+        auto signature = "static " +
+                         (basicBlock == mainRoot
+                              ? std::string{"int64_t"}
+                              : c_type(method->getType(), classNames)) +
+                         " " + c_method_name(className, methodName) + "(";
+        std::set<std::string> parameters;
+        if (basicBlock == mainRoot) {
+            signature += "void";
+        } else {
+            signature += c_declaration(selfType, "self");
+            for (const auto *parameter : method->getParameters()) {
+                parameters.insert(parameter->getID());
+                const auto type = c_type(parameter->getType(), classNames);
+                const auto name = c_variable_name(parameter->getID());
+                signature += ", " + c_declaration(type, name);
+            }
+        }
+        signature += ")";
+        os << signature << ";\n";
+
+        CMethodWriter writer(selfType, std::move(variables),
+                             std::move(parameters));
+        basicBlock->generateC(writer);
+        definitions << "\n";
+        writer.write(definitions, signature);
+    }
+    os << definitions.str();
+
+    if (mainRoot != nullptr) {
+        os << "\nint main(void) {\n";
+        os << "    " << c_method_name(mainRoot->getClassName(),
+                                      mainRoot->getMethodName())
+           << "();\n";
+        os << "    return 0;\n";
+        os << "}\n";
+    }
+}
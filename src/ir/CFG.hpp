@@ -18,6 +18,8 @@ class CFG {
     std::vector<BBlock *> methodRoots;
     int temporaryIndex = 0;
     int blockIndex = 0;
+    // Given to each instruction added, for the bytecode's line table.
+    int currentLine = 0;
     const TypeInfo *type_info_ = nullptr;
 
     [[nodiscard]] BBlock *ownBlock(std::unique_ptr<BBlock> block);
@@ -31,6 +33,8 @@ class CFG {
     BBlock *getCurrentBlock() const { return currentBlock; }
     void setCurrentBlock(BBlock *ptr) { currentBlock = ptr; }
 
+    [[nodiscard]] int getCurrentLine() const { return currentLine; }
+    void setCurrentLine(int line) { currentLine = line; }
     void addInstruction(Tac *ptr);
 
     void printGraphviz(std::ostream &os) const;
@@ -45,6 +49,9 @@ class CFG {
     [[nodiscard]] const std::string *typeOf(const Node &node) const;
 
     void generateBytecode(BytecodeProgram &program, SymbolTable &st);
+    // Writes the program as a single C translation unit with a main
+    // function, for a system C compiler to build into a native executable.
+    void generateC(std::ostream &os, SymbolTable &st);
 };
 
 #endif
@@ -87,7 +87,13 @@ void IRGenerationVisitor::emit_error(int line, std::string message) {
 }
 
 Operand IRGenerationVisitor::eval(const Node &node) {
+    // Instructions take the line of the innermost node they come from.
+    const auto outer_line = graph_.getCurrentLine();
+    if (node.lineno > 0) {
+        graph_.setCurrentLine(node.lineno);
+    }
     node.accept(*this);
+    graph_.setCurrentLine(outer_line);
 
     if (const auto it = values_.find(&node); it != values_.end()) {
         return it->second;
@@ -1,5 +1,7 @@
 #include "ir/LogicalTac.hpp"
 
+#include "codegen/CMethodWriter.hpp"
+
 void LessThanTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(lhsOp).push(rhsOp).less_than().store(result);
 }
@@ -9,3 +11,12 @@ void GreaterThanTac::generateBytecode(BytecodeMethodBlock &block) {
 void EqualToTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(lhsOp).push(rhsOp).equal_to().store(result);
 }
+void LessThanTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_less", {lhsOp, rhsOp}));
+}
+void GreaterThanTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_greater", {lhsOp, rhsOp}));
+}
+void EqualToTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_equal", {lhsOp, rhsOp}));
+}
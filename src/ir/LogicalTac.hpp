@@ -9,6 +9,7 @@ class LessThanTac : public Tac {
                 const Operand &z_)
         : Tac(result_, y_, "<", z_) {};
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class GreaterThanTac : public Tac {
@@ -17,6 +18,7 @@ class GreaterThanTac : public Tac {
                    const Operand &z_)
         : Tac(result_, y_, ">", z_) {};
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class EqualToTac : public Tac {
@@ -24,6 +26,7 @@ class EqualToTac : public Tac {
     EqualToTac(const std::string &result_, const Operand &y_, const Operand &z_)
         : Tac(result_, y_, "==", z_) {};
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 #endif
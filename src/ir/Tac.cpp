@@ -1,5 +1,6 @@
 #include "ir/Tac.hpp"
 #include "bytecode/BytecodeMethodBlock.hpp"
+#include "codegen/CMethodWriter.hpp"
 #include <iostream>
 
 void Tac::print(std::ostream &os) const {
@@ -17,6 +18,9 @@ void CopyTac::print(std::ostream &os) const {
 void CopyTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(rhsOp).store(result);
 }
+void CopyTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.value(rhsOp));
+}
 
 void ArrayCopyTac::print(std::ostream &os) const {
     os << result << "[" << lhs << "]"
@@ -25,6 +29,9 @@ void ArrayCopyTac::print(std::ostream &os) const {
 void ArrayCopyTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(result).push(lhsOp).push(rhsOp).array_store();
 }
+void ArrayCopyTac::generateC(CMethodWriter &writer) {
+    writer.statement(writer.apply("mj_store", {result, lhsOp, rhsOp}));
+}
 
 void ArrayAccessTac::print(std::ostream &os) const {
     os << result << " := " << lhs << "[" << rhs << "]\n";
@@ -32,6 +39,9 @@ void ArrayAccessTac::print(std::ostream &os) const {
 void ArrayAccessTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(lhsOp).push(rhsOp).array_load().store(result);
 }
+void ArrayAccessTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_load", {lhsOp, rhsOp}));
+}
 
 void ArrayLengthTac::print(std::ostream &os) const {
     os << result << " := length " << rhs << "\n";
@@ -39,6 +49,9 @@ void ArrayLengthTac::print(std::ostream &os) const {
 void ArrayLengthTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(rhsOp).array_length().store(result);
 }
+void ArrayLengthTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_length", {rhsOp}));
+}
 
 void NewTac::print(std::ostream &os) const {
     os << result << " := new " << rhs << "\n";
@@ -46,6 +59,9 @@ void NewTac::print(std::ostream &os) const {
 void NewTac::generateBytecode(BytecodeMethodBlock &block) {
     block.new_object(rhs).store(result);
 }
+void NewTac::generateC(CMethodWriter &writer) {
+    writer.new_object(result, rhs);
+}
 
 void NewArrayTac::print(std::ostream &os) const {
     os << result << " := new int, " << rhs << "\n";
@@ -53,11 +69,15 @@ void NewArrayTac::print(std::ostream &os) const {
 void NewArrayTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(rhsOp).new_array().store(result);
 }
+void NewArrayTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_new_array", {rhsOp}));
+}
 
 void JumpTac::print(std::ostream &os) const { os << "goto " << result << "\n"; }
 void JumpTac::generateBytecode(BytecodeMethodBlock &block) {
     block.jump(result);
 }
+void JumpTac::generateC(CMethodWriter &writer) { writer.jump(result); }
 
 void CondJumpTac::print(std::ostream &os) const {
     os << "iffalse " << lhs << " goto " << rhs << "\n";
@@ -65,6 +85,9 @@ void CondJumpTac::print(std::ostream &os) const {
 void CondJumpTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(lhsOp).cjump(rhs);
 }
+void CondJumpTac::generateC(CMethodWriter &writer) {
+    writer.cjump(lhsOp, rhs);
+}
 
 void MethodCallTac::print(std::ostream &os) const {
     os << result << " := call " << op << " on " << lhs << ", " << rhs
@@ -73,11 +96,16 @@ void MethodCallTac::print(std::ostream &os) const {
 void MethodCallTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(lhsOp).call(op).store(result);
 }
+void MethodCallTac::generateC(CMethodWriter &writer) {
+    writer.call(result, lhsOp, op,
+                static_cast<std::size_t>(std::get<int>(rhsOp)));
+}
 
 void ParamTac::print(std::ostream &os) const { os << "param " << rhs << "\n"; }
 void ParamTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(rhsOp);
 }
+void ParamTac::generateC(CMethodWriter &writer) { writer.param(rhsOp); }
 
 void ReturnTac::print(std::ostream &os) const {
     os << "return " << rhs << "\n";
@@ -85,12 +113,19 @@ void ReturnTac::print(std::ostream &os) const {
 void ReturnTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(rhsOp).ret();
 }
+void ReturnTac::generateC(CMethodWriter &writer) { writer.ret(rhsOp); }
 
 void PrintTac::print(std::ostream &os) const { os << "print " << rhs << "\n"; }
 void PrintTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(rhsOp).write();
 }
+void PrintTac::generateC(CMethodWriter &writer) {
+    writer.statement(writer.apply("mj_print", {rhsOp}));
+}
 
 void NotTac::generateBytecode(BytecodeMethodBlock &block) {
     block.push(rhsOp).l_not().store(result);
 }
+void NotTac::generateC(CMethodWriter &writer) {
+    writer.assign(result, writer.apply("mj_not", {rhsOp}));
+}
@@ -6,6 +6,8 @@
 #include <string>
 #include <variant>
 
+class CMethodWriter;
+
 using Operand = std::variant<std::string, int>;
 class Tac {
   protected:
@@ -14,6 +16,9 @@ class Tac {
     std::string op;
     Operand rhsOp;
     std::string lhs, rhs;
+    // Source line of the statement or expression this came from; 0 if
+    // unknown.
+    int line = 0;
 
   private:
     static std::string to_string(const Operand &op) {
@@ -28,13 +33,16 @@ class Tac {
 
     virtual void generateBytecode([[maybe_unused]] BytecodeMethodBlock &block) {
     };
+    virtual void generateC([[maybe_unused]] CMethodWriter &writer) {};
 
     [[nodiscard]] const std::string &getResult() const { return result; }
     [[nodiscard]] const Operand &getLhsOperand() const { return lhsOp; }
     [[nodiscard]] const Operand &getRhsOperand() const { return rhsOp; }
     [[nodiscard]] const std::string &getOperator() const { return op; }
+    [[nodiscard]] int getLine() const { return line; }
 
     void setResult(const std::string &value) { result = value; }
+    void setLine(int value) { line = value; }
     void setLhsOperand(const Operand &value) {
         lhsOp = value;
         lhs = to_string(lhsOp);
@@ -66,6 +74,7 @@ class ArrayCopyTac : public Tac {
         : Tac(result_, index_, ":=", z_) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 class ArrayAccessTac : public Tac {
   public:
@@ -74,6 +83,7 @@ class ArrayAccessTac : public Tac {
         : Tac(result_, y_, "", z_) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 class ArrayLengthTac : public Tac {
   public:
@@ -81,12 +91,14 @@ class ArrayLengthTac : public Tac {
         : Tac(result, y_) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 class NewTac : public Tac {
   public:
     NewTac(const std::string &result, const Operand &y_) : Tac(result, y_) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class NewArrayTac : public Tac {
@@ -95,12 +107,14 @@ class NewArrayTac : public Tac {
         : Tac(result, length_) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class NotTac : public Tac {
   public:
     NotTac(const std::string &result_, const Operand &z_) : Tac(result_, z_) {};
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
     void print(std::ostream &os) const override;
 };
 
@@ -110,6 +124,7 @@ class CopyTac : public Tac {
         : Tac(result_, y_) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class CondJumpTac : public Tac {
@@ -118,6 +133,7 @@ class CondJumpTac : public Tac {
         : Tac("", cond, "", label) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class MethodCallTac : public Tac {
@@ -127,6 +143,7 @@ class MethodCallTac : public Tac {
         : Tac(result, receiver, methodTarget, argCount) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class JumpTac : public Tac {
@@ -134,6 +151,7 @@ class JumpTac : public Tac {
     JumpTac(const std::string &_label) : Tac(_label) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class ParamTac : public Tac {
@@ -141,6 +159,7 @@ class ParamTac : public Tac {
     ParamTac(const Operand &param) : Tac(param) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class ReturnTac : public Tac {
@@ -148,6 +167,7 @@ class ReturnTac : public Tac {
     ReturnTac(const Operand &name) : Tac(name) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 class PrintTac : public Tac {
@@ -155,6 +175,7 @@ class PrintTac : public Tac {
     PrintTac(const Operand &value) : Tac(value) {};
     void print(std::ostream &os) const override;
     void generateBytecode(BytecodeMethodBlock &block) override;
+    void generateC(CMethodWriter &writer) override;
 };
 
 #endif
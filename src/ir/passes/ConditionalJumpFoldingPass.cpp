@@ -121,7 +121,9 @@ build_fold_decision(const CondJumpTac &conditional_jump, int condition_value,
 
 bool apply_fold(BBlock &block, std::vector<std::unique_ptr<Tac>> &instructions,
                 std::size_t index, const FoldDecision &decision) {
+    const auto line = instructions[index]->getLine();
     instructions[index] = std::make_unique<JumpTac>(decision.target_label);
+    instructions[index]->setLine(line);
 
     if (next_jump_instruction(instructions, index) != nullptr) {
         instructions.erase(instructions.begin() + static_cast<long>(index + 1));
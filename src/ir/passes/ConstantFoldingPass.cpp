@@ -117,7 +117,11 @@ try_fold_instruction(const Tac &instruction,
         if (!lhs.has_value() || !rhs.has_value() || *rhs == 0) {
             return std::nullopt;
         }
-        return *lhs / *rhs;
+        // INT64_MIN / -1 wraps around, as it does when the program runs.
+        return *rhs == -1
+                   ? static_cast<std::int64_t>(
+                         0 - static_cast<std::uint64_t>(*lhs))
+                   : *lhs / *rhs;
     }
     if (dynamic_cast<const LessThanTac *>(&instruction) != nullptr) {
         return fold_binary(instruction, environment,
@@ -244,8 +248,10 @@ bool process_block(BBlock &block) {
             const auto folded_immediate = to_ir_immediate(*folded_value);
             if (folded_immediate.has_value()) {
                 const auto result = instruction.getResult();
+                const auto line = instruction.getLine();
                 instruction_ptr =
                     std::make_unique<CopyTac>(*folded_immediate, result);
+                instruction_ptr->setLine(line);
                 environment[result] = *folded_value;
                 changed = true;
                 continue;
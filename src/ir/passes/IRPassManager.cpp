@@ -5,14 +5,16 @@
 
 #include "ir/CFG.hpp"
 #include "ir/passes/IRPass.hpp"
+#include "util/TimeReport.hpp"
 
 void IRPassManager::addPass(std::unique_ptr<IRPass> pass) {
     passes_.push_back(std::move(pass));
 }
 
-bool IRPassManager::run(CFG &graph) const {
+bool IRPassManager::run(CFG &graph, TimeReport *report) const {
     bool changed = false;
     for (const auto &pass : passes_) {
+        const TimeReport::Scope timer(report, pass->name());
         changed = pass->run(graph) || changed;
     }
     return changed;
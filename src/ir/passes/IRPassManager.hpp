@@ -6,11 +6,13 @@
 
 class CFG;
 class IRPass;
+class TimeReport;
 
 class IRPassManager {
   public:
     void addPass(std::unique_ptr<IRPass> pass);
-    [[nodiscard]] bool run(CFG &graph) const;
+    // Times each pass in report when one is given.
+    [[nodiscard]] bool run(CFG &graph, TimeReport *report = nullptr) const;
 
   private:
     std::vector<std::unique_ptr<IRPass>> passes_;
@@ -1,29 +1,37 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <optional>
+#include <set>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 #include "ast/Node.h"
-#include "bytecode/BytecodeProgram.hpp"
-#include "ir/CFG.hpp"
-#include "ir/IRGenerationVisitor.hpp"
-#include "ir/passes/ConditionalJumpFoldingPass.hpp"
-#include "ir/passes/ConstantFoldingPass.hpp"
-#include "ir/passes/IRPassManager.hpp"
+#include "codegen/NativeCompiler.hpp"
+#include "driver/CompilationSession.hpp"
+#include "driver/Server.hpp"
 #include "lexing/LegacyDiagnostics.hpp"
 #include "lexing/Lexer.hpp"
 #include "lexing/SourceBuffer.hpp"
 #include "lexing/StringViewStream.hpp"
-#include "parsing/Parser.hpp"
-#include "semantic/SymbolTableVisitor.hpp"
-#include "semantic/TypeCheckVisitor.hpp"
-
-std::unique_ptr<Node> root;
-int lexical_errors = 0;
+#include "util/TimeReport.hpp"
+#include "util/WorkStealing.hpp"
+#include "vm/Interpreter.hpp"
 
 enum errCodes {
     SUCCESS = 0,
@@ -34,27 +42,6 @@ enum errCodes {
     SEGMENTATION_FAULT = 139
 };
 
-int errCode = errCodes::SUCCESS;
-
-class ConditionalDiagnosticSink final : public lexing::DiagnosticSink {
-  public:
-    explicit ConditionalDiagnosticSink(int *gate, std::ostream &out = std::cerr)
-        : gate_(gate), out_(&out) {}
-
-    void emit(lexing::Diagnostic d) override {
-        if (gate_ != nullptr && *gate_ != 0) {
-            return;
-        }
-        if (out_ != nullptr) {
-            (*out_) << d.message;
-        }
-    }
-
-  private:
-    int *gate_ = nullptr;
-    std::ostream *out_ = nullptr;
-};
-
 void print_legacy_token(const lexing::Token &token) {
     using lexing::TokenKind;
     switch (token.kind) {
@@ -197,10 +184,281 @@ void printTree(const Node *root) {
     root->print(depth);
 }
 
+struct OutputOptions {
+    bool emitC = false;
+    bool native = false;
+    bool writeBytecode = true;
+};
+
+// Writes the diagrams and bytecode of a compiled program into directory, and
+// C or native code if asked for. Returns false, after reporting why to err,
+// if one of them could not be produced.
+bool writeOutputs(CompilationSession &session, const fs::path &directory,
+                  const OutputOptions &options, std::ostream &err,
+                  TimeReport *report = nullptr) {
+    {
+        const TimeReport::Scope timer(report, "write tree.dot");
+        std::ofstream outStream(directory / "tree.dot");
+        generateGraphviz(session.getRoot(), outStream);
+    }
+
+    {
+        const TimeReport::Scope timer(report, "write cfg.dot");
+        std::ofstream controlFlowGraph(directory / "cfg.dot");
+        if (!controlFlowGraph.is_open()) {
+            err << "Failed to open file cfg.dot.\n";
+            return false;
+        }
+        session.getGraph().printGraphviz(controlFlowGraph);
+    }
+
+    {
+        const TimeReport::Scope timer(report, "write st.dot");
+        std::ofstream stGraph(directory / "st.dot");
+        session.getSymbolTable().printTable(stGraph);
+    }
+
+    const auto &program = session.getProgram();
+    {
+        const TimeReport::Scope timer(report, "write bytecode.txt");
+        std::ofstream prettyBytecode(directory / "bytecode.txt");
+        program.print(prettyBytecode);
+    }
+
+    if (options.writeBytecode) {
+        const TimeReport::Scope timer(report, "serialize prog.bc");
+        std::ofstream bytecodeProgram(directory / "prog.bc");
+        program.serialize(bytecodeProgram);
+    }
+
+    if (options.emitC || options.native) {
+        const auto cPath = directory / "prog.c";
+        {
+            const TimeReport::Scope timer(report, "generate_c");
+            std::ofstream cProgram(cPath);
+            session.generateC(cProgram);
+        }
+
+        if (options.native) {
+            const TimeReport::Scope timer(report, "native cc");
+            // The output sits next to prog.bc.
+            if (!compileNative(cPath, directory / "prog")) {
+                err << "Failed to compile prog.c with "
+                    << nativeCompilerCommand().front() << ".\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+const char *describe(CompileStatus status) {
+    switch (status) {
+    case CompileStatus::Success:
+        return "ok";
+    case CompileStatus::LexicalError:
+        return "lexical error";
+    case CompileStatus::SyntaxError:
+        return "syntax error";
+    case CompileStatus::SymbolTableError:
+        return "symbol table error";
+    case CompileStatus::TypeError:
+        return "type error";
+    case CompileStatus::IRError:
+        return "IR error";
+    }
+    return "error";
+}
+
+struct BatchInput {
+    fs::path source;
+    // Where its outputs go, relative to the output directory.
+    fs::path outputName;
+};
+
+// Expands the paths given on the command line into the files to compile:
+// files as given, and every .java file below a directory. Files found in a
+// directory keep their place in it under the output directory; others are
+// named after the file.
+bool collectBatchInputs(const std::vector<std::string> &paths,
+                        std::vector<BatchInput> &inputs) {
+    std::set<fs::path> usedNames;
+    const auto add = [&](const fs::path &source, fs::path name) {
+        name.replace_extension();
+        auto unique = name;
+        for (int suffix = 2; !usedNames.insert(unique).second; suffix++) {
+            unique = name;
+            unique += "-" + std::to_string(suffix);
+        }
+        inputs.push_back({source, unique});
+    };
+
+    for (const auto &path : paths) {
+        std::error_code ec;
+        if (!fs::is_directory(path, ec)) {
+            add(path, fs::path(path).filename());
+            continue;
+        }
+        std::vector<fs::path> sources;
+        for (fs::recursive_directory_iterator it(path, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file() && it->path().extension() == ".java") {
+                sources.push_back(it->path());
+            }
+        }
+        if (ec) {
+            std::cerr << "Failed to read directory '" << path
+                      << "': " << ec.message() << ".\n";
+            return false;
+        }
+        std::ranges::sort(sources);
+        for (const auto &source : sources) {
+            add(source, source.lexically_relative(path));
+        }
+    }
+    return true;
+}
+
+// Compiles every input on a pool of jobs threads, writing the outputs of each
+// into its own directory below outputDirectory, then reports each file's
+// result and time in input order. Returns the highest exit code of any file.
+int compileBatch(const std::vector<BatchInput> &inputs,
+                 const fs::path &outputDirectory, unsigned jobs,
+                 const OutputOptions &options) {
+    struct Result {
+        int exitCode = errCodes::SUCCESS;
+        const char *status = "ok";
+        double milliseconds = 0;
+        std::string messages;
+    };
+    std::vector<Result> results(inputs.size());
+
+    // Start the largest files first so that none of them is left running
+    // alone at the end.
+    std::vector<size_t> order(inputs.size());
+    std::vector<std::uintmax_t> sizes(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        std::error_code ec;
+        const auto size = fs::file_size(inputs[i].source, ec);
+        order[i] = i;
+        sizes[i] = ec ? 0 : size;
+    }
+    std::ranges::stable_sort(order, [&](size_t a, size_t b) {
+        return sizes[a] > sizes[b];
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    runWorkStealing(inputs.size(), jobs, [&](size_t task) {
+        const auto &input = inputs[order[task]];
+        auto &result = results[order[task]];
+        const auto fileStart = std::chrono::steady_clock::now();
+        std::ostringstream messages;
+
+        std::string error;
+        auto source = lexing::SourceBuffer::from_file(input.source, error);
+        if (!source.has_value()) {
+            messages << error << "\n";
+            result.exitCode = 1;
+            result.status = "unreadable";
+        } else {
+            CompilationSession session(std::move(*source));
+            const auto status = session.compile();
+            session.report(messages, messages);
+            result.exitCode = exitCode(status);
+            result.status = describe(status);
+
+            if (status == CompileStatus::Success) {
+                const auto directory = outputDirectory / input.outputName;
+                std::error_code ec;
+                fs::create_directories(directory, ec);
+                if (ec) {
+                    messages << "Failed to create directory '"
+                             << directory.string() << "'.\n";
+                }
+                if (ec ||
+                    !writeOutputs(session, directory, options, messages)) {
+                    result.exitCode = 1;
+                    result.status = "output error";
+                }
+            }
+        }
+
+        result.messages = std::move(messages).str();
+        result.milliseconds = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - fileStart)
+                                  .count();
+    });
+    const auto seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+    int worst = errCodes::SUCCESS;
+    size_t failed = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const auto &result = results[i];
+        if (!result.messages.empty()) {
+            std::cerr << inputs[i].source.string() << ":\n" << result.messages;
+        }
+        std::cout << std::fixed << std::setprecision(3) << std::setw(10)
+                  << result.milliseconds << " ms  " << result.status << "  "
+                  << inputs[i].source.string() << "\n";
+        if (result.exitCode != errCodes::SUCCESS) {
+            failed += 1;
+            worst = std::max(worst, result.exitCode);
+        }
+    }
+    std::cout << "Compiled " << inputs.size() << " files";
+    if (failed != 0) {
+        std::cout << " (" << failed << " failed)";
+    }
+    const auto threads = std::min<size_t>(jobs, inputs.size());
+    std::cout << " in " << std::setprecision(3) << seconds << " s on "
+              << threads << (threads == 1 ? " thread: " : " threads: ")
+              << std::setprecision(1)
+              << (seconds > 0 ? inputs.size() / seconds : 0.0)
+              << " files/sec\n";
+    return worst;
+}
+
+// Compiles one program, writes its outputs and, given runOptions, runs it.
+// Returns the compiler's exit code.
+int compileProgram(lexing::SourceBuffer buffer,
+                   const fs::path &outputDirectory,
+                   const OutputOptions &options, const VmOptions *runOptions,
+                   TimeReport *report) {
+    CompilationSession session(std::move(buffer));
+    const auto status = session.compile(report);
+    session.report(std::cout, std::cerr);
+    if (status != CompileStatus::Success) {
+        return exitCode(status);
+    }
+
+    if (!writeOutputs(session, outputDirectory, options, std::cerr, report)) {
+        return 1;
+    }
+
+    if (runOptions != nullptr) {
+        const TimeReport::Scope timer(report, "run");
+        if (!runBytecodeProgram(session.getProgram(), *runOptions)) {
+            return 1;
+        }
+    }
+    return errCodes::SUCCESS;
+}
+
 int main(int argc, char **argv) {
     const std::string outputDirectoryName = "output";
     bool lex_only = false;
-    std::string input_path;
+    bool emit_c = false;
+    bool native = false;
+    bool run = false;
+    bool serve = false;
+    bool print_time_report = false;
+    std::string trace_path;
+    std::string serve_socket;
+    unsigned jobs = std::max(std::thread::hardware_concurrency(), 1U);
+    VmOptions vm_options;
+    std::vector<std::string> input_paths;
 
     for (int i = 1; i < argc; ++i) {
         std::string_view arg = argv[i];
@@ -208,9 +466,89 @@ int main(int argc, char **argv) {
             lex_only = true;
             continue;
         }
-        if (input_path.empty()) {
-            input_path = argv[i];
+        if (arg == "--emit=c") {
+            emit_c = true;
+            continue;
+        }
+        if (arg == "--native") {
+            native = true;
+            continue;
+        }
+        if (arg == "--run") {
+            run = true;
+            continue;
+        }
+        if (arg == "--time-report") {
+            print_time_report = true;
+            continue;
+        }
+        if (constexpr std::string_view traceFlag = "--time-trace=";
+            arg.starts_with(traceFlag)) {
+            trace_path = arg.substr(traceFlag.size());
+            continue;
+        }
+        if (arg == "--serve") {
+            serve = true;
+            continue;
+        }
+        if (constexpr std::string_view serveFlag = "--serve=";
+            arg.starts_with(serveFlag)) {
+            serve = true;
+            serve_socket = arg.substr(serveFlag.size());
+            continue;
+        }
+        if (constexpr std::string_view jobsFlag = "--jobs=";
+            arg.starts_with(jobsFlag)) {
+            const auto value = arg.substr(jobsFlag.size());
+            const auto [end, ec] = std::from_chars(
+                value.data(), value.data() + value.size(), jobs);
+            if (ec != std::errc() || end != value.data() + value.size() ||
+                jobs == 0) {
+                std::cerr << "Error: Invalid job count " << value << ".\n";
+                return 1;
+            }
+            continue;
+        }
+        try {
+            if (parseVmFlag(arg, vm_options)) {
+                continue;
+            }
+        } catch (const std::exception &exc) {
+            std::cerr << "Error: " << exc.what() << ".\n";
+            return 1;
+        }
+        input_paths.emplace_back(arg);
+    }
+
+    if (serve) {
+        if (!input_paths.empty() || lex_only || run) {
+            std::cerr << "Error: --serve takes its programs from requests.\n";
+            return 1;
         }
+        const bool served = serve_socket.empty()
+                                ? serveConnection(0, 1, vm_options)
+                                : serveSocket(serve_socket, vm_options);
+        return served ? errCodes::SUCCESS : 1;
+    }
+
+    // Several inputs, or a directory of them, are compiled as a batch.
+    std::error_code ec;
+    const bool batch = input_paths.size() > 1 ||
+                       (input_paths.size() == 1 &&
+                        fs::is_directory(input_paths.front(), ec));
+    const bool timed = print_time_report || !trace_path.empty();
+    if (batch && (lex_only || run || timed)) {
+        std::cerr << "Error: "
+                  << (lex_only ? "--lex" : run ? "--run" : "--time-report")
+                  << " takes a single input file.\n";
+        return 1;
+    }
+
+    // A program run straight from its source can list that source's lines.
+    auto &interpreter_options = vm_options.interpreter;
+    if (run && interpreter_options.sourcePath.empty() &&
+        !input_paths.empty()) {
+        interpreter_options.sourcePath = input_paths.front();
     }
 
     if (!fs::exists(outputDirectoryName)) {
@@ -223,26 +561,46 @@ int main(int argc, char **argv) {
 
     const auto &currentDirectory = std::filesystem::current_path();
     const auto &outputDirectory = currentDirectory / outputDirectoryName;
+    const OutputOptions output_options{
+        .emitC = emit_c, .native = native, .writeBytecode = !run};
+
+    if (batch) {
+        std::vector<BatchInput> inputs;
+        if (!collectBatchInputs(input_paths, inputs)) {
+            return 1;
+        }
+        return compileBatch(inputs, outputDirectory, jobs, output_options);
+    }
+
+    std::optional<TimeReport> time_report;
+    if (timed && !lex_only) {
+        time_report.emplace();
+    }
+    TimeReport *report = time_report ? &*time_report : nullptr;
 
-    lexical_errors = 0;
     std::string error;
     lexing::SourceBuffer buffer =
         lexing::SourceBuffer::from_string(std::string{});
 
-    if (!input_path.empty()) {
-        auto loaded = lexing::SourceBuffer::from_file(input_path, error);
-        if (!loaded.has_value()) {
-            std::cerr << error << "\n";
-            return 1;
+    {
+        const TimeReport::Scope timer(report, "read source");
+        if (!input_paths.empty()) {
+            auto loaded =
+                lexing::SourceBuffer::from_file(input_paths.front(), error);
+            if (!loaded.has_value()) {
+                std::cerr << error << "\n";
+                return 1;
+            }
+            buffer = std::move(*loaded);
+        } else {
+            std::string data((std::istreambuf_iterator<char>(std::cin)),
+                             std::istreambuf_iterator<char>());
+            buffer = lexing::SourceBuffer::from_string(std::move(data));
         }
-        buffer = std::move(*loaded);
-    } else {
-        std::string data((std::istreambuf_iterator<char>(std::cin)),
-                         std::istreambuf_iterator<char>());
-        buffer = lexing::SourceBuffer::from_string(std::move(data));
     }
 
     if (lex_only) {
+        int lexical_errors = 0;
         auto stream = std::make_unique<lexing::StringViewStream>(buffer.view());
         lexing::LegacyDiagnosticSink diag(&lexical_errors);
         lexing::Lexer lexer(std::move(stream), buffer.view(), &diag);
@@ -261,82 +619,21 @@ int main(int argc, char **argv) {
         return lexical_errors ? errCodes::LEXICAL_ERROR : errCodes::SUCCESS;
     }
 
-    auto stream = std::make_unique<lexing::StringViewStream>(buffer.view());
-    lexing::LegacyDiagnosticSink lex_diag(&lexical_errors);
-    lexing::Lexer lexer(std::move(stream), buffer.view(), &lex_diag);
-    ConditionalDiagnosticSink syntax_diag(&lexical_errors);
-    parsing::Parser parser(std::move(lexer), &syntax_diag);
-
-    auto parse_result = parser.parse_goal();
-    if (!parse_result.has_value()) {
-        errCode = errCodes::SYNTAX_ERROR;
-        return errCodes::SYNTAX_ERROR;
-    }
-    root = std::move(parse_result.value());
-
-    if (lexical_errors) {
-        return errCodes::LEXICAL_ERROR;
-    }
-
-    SymbolTable st;
-    lexing::LegacyDiagnosticSink semantic_diag;
-    auto symbol_table_result = build_symbol_table(*root, st, &semantic_diag);
-    bool symbolTableSuccess = symbol_table_result.ok();
-    if (!symbolTableSuccess) {
-        std::cout << "Symbol table construction failed.\n";
-    }
-
-    bool typeCheckSuccess = true;
-    TypeInfo type_info;
-    if (symbolTableSuccess) {
-        const auto type_check_result =
-            check_types(*root, st, &type_info, &semantic_diag);
-        typeCheckSuccess = type_check_result.ok();
-        if (!typeCheckSuccess) {
-            std::cout << "Type checking failed.\n";
+    const auto code =
+        compileProgram(std::move(buffer), outputDirectory, output_options,
+                       run ? &vm_options : nullptr, report);
+    if (time_report.has_value()) {
+        if (print_time_report) {
+            time_report->print(std::cerr);
+        }
+        if (!trace_path.empty()) {
+            std::ofstream trace(trace_path);
+            if (!trace.is_open()) {
+                std::cerr << "Failed to open file " << trace_path << ".\n";
+                return 1;
+            }
+            time_report->writeChromeTrace(trace);
         }
     }
-
-    if (!symbolTableSuccess || !typeCheckSuccess) {
-        return errCodes::SEMANTIC_ERROR;
-    }
-
-    std::ofstream outStream(outputDirectory / "tree.dot");
-    generateGraphviz(root.get(), outStream);
-
-    CFG graph;
-    graph.setTypeInfo(&type_info);
-    std::ofstream controlFlowGraph(outputDirectory / "cfg.dot");
-
-    if (!controlFlowGraph.is_open()) {
-        std::cerr << "Failed to open file cfg.dot.\n";
-        return 1;
-    }
-
-    const auto ir_result = generate_ir(*root, graph, st, &semantic_diag);
-    if (!ir_result.ok()) {
-        std::cout << "IR generation failed.\n";
-        return errCodes::SEMANTIC_ERROR;
-    }
-
-    IRPassManager pass_manager;
-    pass_manager.addPass(std::make_unique<ConstantFoldingPass>());
-    pass_manager.addPass(std::make_unique<ConditionalJumpFoldingPass>());
-    (void)pass_manager.run(graph);
-
-    graph.printGraphviz(controlFlowGraph);
-
-    std::ofstream stGraph(outputDirectory / "st.dot");
-    st.printTable(stGraph);
-
-    BytecodeProgram program;
-    graph.generateBytecode(program, st);
-
-    std::ofstream prettyBytecode(outputDirectory / "bytecode.txt");
-    program.print(prettyBytecode);
-
-    std::ofstream bytecodeProgram(outputDirectory / "prog.bc");
-    program.serialize(bytecodeProgram);
-
-    return errCodes::SUCCESS;
+    return code;
 }
@@ -270,7 +270,13 @@ int Parser::error_count() const { return error_count_; }
 
 const lexing::Token &Parser::peek(std::size_t n) {
     while (buffer_.size() <= n) {
+        if (lex_timer_ != nullptr) {
+            lex_timer_->start();
+        }
         lexing::Token const token = lexer_.next();
+        if (lex_timer_ != nullptr) {
+            lex_timer_->stop();
+        }
         if (token.kind == lexing::TokenKind::Invalid) {
             continue;
         }
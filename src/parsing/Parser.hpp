@@ -9,6 +9,8 @@
 #include "ast/Node.h"
 #include "lexing/Lexer.hpp"
 #include "lexing/Token.hpp"
+#include "util/TimeReport.hpp"
+
 namespace parsing {
 
 enum class ParseErrorKind : std::uint8_t {
@@ -35,6 +37,11 @@ class Parser {
     bool has_errors() const;
     int error_count() const;
 
+    // Times the lexer, which runs on demand while parsing, separately.
+    void time_lexing(PhaseAccumulator *accumulator) {
+        lex_timer_ = accumulator;
+    }
+
   private:
     const lexing::Token &peek(std::size_t n = 0);
     lexing::Token consume();
@@ -66,6 +73,7 @@ class Parser {
 
     lexing::Lexer lexer_;
     lexing::DiagnosticSink *sink_ = nullptr;
+    PhaseAccumulator *lex_timer_ = nullptr;
     std::deque<lexing::Token> buffer_;
     int error_count_ = 0;
     bool reported_syntax_error_ = false;
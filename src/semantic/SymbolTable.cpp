@@ -99,3 +99,20 @@ Scope *SymbolTable::resolveScope(const std::string &className,
 
     return scope;
 }
+
+Scope *SymbolTable::resolveClassScope(const std::string &className) {
+    auto *classLookup = lookupClass(className);
+    if (classLookup == nullptr) {
+        return nullptr;
+    }
+
+    enterClassScope(classLookup);
+    Scope *scope = getCurrentScope();
+    exitScope();
+
+    return scope;
+}
+
+std::set<std::string> SymbolTable::getClassNames() const {
+    return root->getClassNames();
+}
@@ -2,6 +2,8 @@
 #define SYMBOL_TABLE_HPP
 
 #include <memory>
+#include <set>
+#include <string>
 
 #include "semantic/Class.hpp"
 #include "semantic/Scope.hpp"
@@ -47,6 +49,8 @@ class SymbolTable {
 
     [[nodiscard]] Scope *resolveScope(const std::string &className,
                                       const std::string &methodName);
+    [[nodiscard]] Scope *resolveClassScope(const std::string &className);
+    [[nodiscard]] std::set<std::string> getClassNames() const;
 };
 
 #endif
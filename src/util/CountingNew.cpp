@@ -0,0 +1,56 @@
+// Replaces the ordinary forms of global operator new and delete with malloc
+// and free wrappers that count each allocation for threadAllocations. Linked
+// only into the programs that report allocations, never into minijava_core,
+// so embedders keep their own allocator and ASan keeps its new/delete
+// checks elsewhere.
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "util/TimeReport.hpp"
+
+namespace {
+
+void *allocate(size_t size) {
+    countAllocation(size);
+    // malloc(0) may return null; operator new must not.
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *allocateOrThrow(size_t size) {
+    void *pointer = allocate(size);
+    while (pointer == nullptr) {
+        const auto handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+        pointer = std::malloc(size == 0 ? 1 : size);
+    }
+    return pointer;
+}
+
+[[maybe_unused]] const bool installed = (installAllocationCounting(), true);
+
+} // namespace
+
+// The aligned forms are left to the standard library.
+void *operator new(size_t size) { return allocateOrThrow(size); }
+void *operator new[](size_t size) { return allocateOrThrow(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+    std::free(pointer);
+}
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+    std::free(pointer);
+}
@@ -0,0 +1,22 @@
+#include "util/Json.hpp"
+
+#include <iomanip>
+
+void writeJsonString(std::ostream &os, std::string_view str) {
+    os << '"';
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            const auto flags = os.flags();
+            const auto fill = os.fill('0');
+            os << "\\u" << std::hex << std::setw(4)
+               << static_cast<int>(static_cast<unsigned char>(c));
+            os.flags(flags);
+            os.fill(fill);
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
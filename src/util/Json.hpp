@@ -0,0 +1,10 @@
+#ifndef JSON_HPP
+#define JSON_HPP
+
+#include <ostream>
+#include <string_view>
+
+// Writes str as a quoted JSON string, escaping what JSON requires.
+void writeJsonString(std::ostream &os, std::string_view str);
+
+#endif
@@ -0,0 +1,130 @@
+#include "util/PerfCounters.hpp"
+
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#if __has_include(<linux/perf_event.h>) && __has_include(<sys/syscall.h>)
+#define MINIJAVA_PERF_EVENTS 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#define MINIJAVA_PERF_EVENTS 0
+#endif
+
+std::string_view perfEventName(PerfEvent event) {
+    switch (event) {
+    case PerfEvent::Cycles:
+        return "cycles";
+    case PerfEvent::Instructions:
+        return "instructions";
+    case PerfEvent::BranchMisses:
+        return "branch misses";
+    case PerfEvent::CacheMisses:
+        return "cache misses";
+    }
+    return "unknown";
+}
+
+#if MINIJAVA_PERF_EVENTS
+namespace {
+
+constexpr std::array<std::uint64_t, perfEventCount> hardwareEvents = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES};
+
+int openEvent(std::uint64_t config, int groupFd) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    // Only the leader starts disabled; the others count whenever it does.
+    attr.disabled = groupFd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+} // namespace
+
+PerfCounters::PerfCounters() {
+    fds.fill(-1);
+    int error = 0;
+    for (size_t i = 0; i < perfEventCount; i++) {
+        const auto fd = openEvent(hardwareEvents[i], leader);
+        if (fd == -1) {
+            error = errno;
+            continue;
+        }
+        if (leader == -1) {
+            leader = fd;
+        }
+        fds[i] = fd;
+        order[opened++] = i;
+    }
+    if (leader == -1) {
+        throw std::system_error(error, std::generic_category(),
+                                "hardware performance counters are not "
+                                "available");
+    }
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::~PerfCounters() {
+    for (const auto fd : fds) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+}
+
+void PerfCounters::start() {
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::stop() {
+    ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounts PerfCounters::read() const {
+    // nr, time enabled, time running, then one value per opened event.
+    std::array<std::uint64_t, 3 + perfEventCount> buffer{};
+    const auto bytes = ::read(leader, buffer.data(), sizeof(buffer));
+    if (bytes < static_cast<ssize_t>(3 * sizeof(std::uint64_t)) ||
+        buffer[0] != opened) {
+        throw std::runtime_error("unable to read performance counters");
+    }
+    const auto enabled = buffer[1];
+    const auto running = buffer[2];
+    PerfCounts counts;
+    for (size_t i = 0; i < opened; i++) {
+        auto value = buffer[3 + i];
+        if (running != 0 && running < enabled) {
+            value = static_cast<std::uint64_t>(
+                static_cast<double>(value) * static_cast<double>(enabled) /
+                static_cast<double>(running));
+        }
+        counts.values[order[i]] = value;
+    }
+    return counts;
+}
+#else
+PerfCounters::PerfCounters() {
+    fds.fill(-1);
+    throw std::runtime_error("hardware performance counters need Linux");
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::start() {}
+
+void PerfCounters::stop() {}
+
+PerfCounts PerfCounters::read() const { return {}; }
+#endif
@@ -0,0 +1,74 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Hardware events that PerfCounters counts.
+enum class PerfEvent : std::uint8_t {
+    Cycles,
+    Instructions,
+    BranchMisses,
+    CacheMisses
+};
+inline constexpr size_t perfEventCount = 4;
+
+// "cycles", "instructions", "branch misses" or "cache misses".
+[[nodiscard]] std::string_view perfEventName(PerfEvent event);
+
+// A reading of every event, indexed by PerfEvent.
+struct PerfCounts {
+    std::array<std::uint64_t, perfEventCount> values{};
+
+    [[nodiscard]] std::uint64_t operator[](PerfEvent event) const {
+        return values[static_cast<size_t>(event)];
+    }
+    PerfCounts &operator+=(const PerfCounts &other) {
+        for (size_t i = 0; i < perfEventCount; i++) {
+            values[i] += other.values[i];
+        }
+        return *this;
+    }
+    friend PerfCounts operator-(PerfCounts lhs, const PerfCounts &rhs) {
+        for (size_t i = 0; i < perfEventCount; i++) {
+            lhs.values[i] -= rhs.values[i];
+        }
+        return lhs;
+    }
+};
+
+// Counts hardware events of the calling thread, in user space only, with
+// Linux perf_event_open. The events form one group so they are scheduled
+// onto the PMU together; if the kernel still has to multiplex them, readings
+// are scaled up to the whole time counting was enabled. Events the CPU does
+// not offer are left out and read as 0.
+class PerfCounters {
+    // The group leader comes first; -1 for events that could not be opened.
+    std::array<int, perfEventCount> fds;
+    // The order of the opened events in a group read.
+    std::array<size_t, perfEventCount> order{};
+    size_t opened = 0;
+    int leader = -1;
+
+  public:
+    // Opens the counters, stopped and at zero. Throws std::runtime_error if
+    // none of them can be opened, as when the kernel forbids it
+    // (kernel.perf_event_paranoid), or off Linux.
+    PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+    ~PerfCounters();
+
+    [[nodiscard]] bool available(PerfEvent event) const {
+        return fds[static_cast<size_t>(event)] != -1;
+    }
+    void start();
+    void stop();
+    // The counts since the counters were opened. Cheap enough to call on
+    // every method call, but still a system call.
+    [[nodiscard]] PerfCounts read() const;
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "util/TimeReport.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+#include "util/Json.hpp"
+
+#if __has_include(<sys/resource.h>)
+#define MINIJAVA_RUSAGE 1
+#include <sys/resource.h>
+#else
+#define MINIJAVA_RUSAGE 0
+#endif
+
+namespace {
+
+constinit thread_local AllocationCounts allocationCounts;
+std::atomic<bool> countingInstalled{false};
+
+// Milliseconds with three decimals.
+std::string milliseconds(std::chrono::nanoseconds duration) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3)
+       << std::chrono::duration<double, std::milli>(duration).count();
+    return std::move(os).str();
+}
+
+AllocationCounts operator-(const AllocationCounts &a,
+                           const AllocationCounts &b) {
+    return {a.count - b.count, a.bytes - b.bytes};
+}
+
+} // namespace
+
+void countAllocation(size_t bytes) noexcept {
+    allocationCounts.count += 1;
+    allocationCounts.bytes += bytes;
+}
+
+void installAllocationCounting() noexcept {
+    countingInstalled.store(true, std::memory_order_relaxed);
+}
+
+bool allocationsCounted() {
+    return countingInstalled.load(std::memory_order_relaxed);
+}
+
+AllocationCounts threadAllocations() { return allocationCounts; }
+
+long peakResidentKiB() {
+#if MINIJAVA_RUSAGE
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+void TimeReport::addPhase(Phase phase) {
+    const auto before = threadAllocations();
+    phases.push_back(std::move(phase));
+    const auto added = threadAllocations() - before;
+    bookkeeping.count += added.count;
+    bookkeeping.bytes += added.bytes;
+}
+
+TimeReport::Scope::Scope(TimeReport *report_, std::string_view name)
+    : report(report_) {
+    if (report == nullptr) {
+        return;
+    }
+    index = report->phases.size();
+    report->addPhase({.name = std::string(name),
+                      .depth = report->depth,
+                      .start =
+                          std::chrono::steady_clock::now() - report->created,
+                      .duration = {},
+                      .allocations = {},
+                      .peakResidentKiB = 0});
+    report->depth += 1;
+    startAllocations = threadAllocations();
+    startBookkeeping = report->bookkeeping;
+}
+
+TimeReport::Scope::~Scope() {
+    if (report == nullptr) {
+        return;
+    }
+    const auto end = std::chrono::steady_clock::now() - report->created;
+    auto &phase = report->phases[index];
+    phase.duration = end - phase.start;
+    phase.allocations = threadAllocations() - startAllocations -
+                        (report->bookkeeping - startBookkeeping);
+    phase.peakResidentKiB = peakResidentKiB();
+    report->depth -= 1;
+}
+
+void TimeReport::add(std::string_view name,
+                     const PhaseAccumulator &accumulator) {
+    addPhase({.name = std::string(name),
+              .depth = depth,
+              .start = std::chrono::steady_clock::now() - created -
+                       accumulator.duration,
+              .duration = accumulator.duration,
+              .allocations = accumulator.allocations,
+              .peakResidentKiB = peakResidentKiB()});
+}
+
+void TimeReport::print(std::ostream &os) const {
+    size_t nameWidth = 5;
+    for (const auto &phase : phases) {
+        nameWidth = std::max(nameWidth, 2 * phase.depth + phase.name.size());
+    }
+    os << std::left << std::setw(static_cast<int>(nameWidth)) << "Phase"
+       << std::right << std::setw(12) << "Wall ms" << std::setw(12)
+       << "Allocs" << std::setw(14) << "Alloc bytes" << std::setw(14)
+       << "Peak RSS KiB" << '\n';
+    const bool counted = allocationsCounted();
+    const auto row = [&](const std::string &name,
+                         std::chrono::nanoseconds duration,
+                         const AllocationCounts &allocations, long peak) {
+        os << std::left << std::setw(static_cast<int>(nameWidth)) << name
+           << std::right << std::setw(12) << milliseconds(duration);
+        if (counted) {
+            os << std::setw(12) << allocations.count << std::setw(14)
+               << allocations.bytes;
+        } else {
+            os << std::setw(12) << "-" << std::setw(14) << "-";
+        }
+        os << std::setw(14) << peak << '\n';
+    };
+    for (const auto &phase : phases) {
+        row(std::string(2 * phase.depth, ' ') + phase.name, phase.duration,
+            phase.allocations, phase.peakResidentKiB);
+    }
+    row("total", std::chrono::steady_clock::now() - created,
+        threadAllocations() - createdAllocations - bookkeeping,
+        peakResidentKiB());
+}
+
+void TimeReport::writeChromeTrace(std::ostream &os) const {
+    // Complete ("X") events, with times in microseconds.
+    const auto micros = [](std::chrono::nanoseconds duration) {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    };
+    os << "{\"traceEvents\":[";
+    for (size_t i = 0; i < phases.size(); i++) {
+        const auto &phase = phases[i];
+        os << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString(os, phase.name);
+        os << std::fixed << std::setprecision(3)
+           << ",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << micros(phase.start)
+           << ",\"dur\":" << micros(phase.duration) << ",\"args\":{";
+        if (allocationsCounted()) {
+            os << "\"allocations\":" << phase.allocations.count
+               << ",\"allocated_bytes\":" << phase.allocations.bytes << ",";
+        }
+        os << "\"peak_rss_kib\":" << phase.peakResidentKiB << "}}";
+    }
+    os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
@@ -0,0 +1,112 @@
+#ifndef TIME_REPORT_HPP
+#define TIME_REPORT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Allocations made through operator new on the calling thread so far.
+// Counting needs a replacement operator new that calls countAllocation,
+// which the library does not impose on programs that link it: the compiler
+// and vm_bench link the one in util/CountingNew.cpp. Elsewhere the counts
+// stay zero.
+struct AllocationCounts {
+    std::uint64_t count = 0;
+    std::uint64_t bytes = 0;
+};
+[[nodiscard]] AllocationCounts threadAllocations();
+void countAllocation(size_t bytes) noexcept;
+// Called by a counting operator new when the program starts, so reports can
+// tell no allocations from allocations not counted.
+void installAllocationCounting() noexcept;
+[[nodiscard]] bool allocationsCounted();
+
+// The most memory the process has had resident so far, in KiB, or 0 where
+// that is unknown.
+[[nodiscard]] long peakResidentKiB();
+
+// Time and allocations summed over many short intervals, for work that is
+// interleaved with other work, like lexing is with parsing.
+class PhaseAccumulator {
+    std::chrono::steady_clock::time_point startTime;
+    AllocationCounts startAllocations;
+
+  public:
+    std::chrono::nanoseconds duration{};
+    AllocationCounts allocations;
+
+    void start() {
+        startAllocations = threadAllocations();
+        startTime = std::chrono::steady_clock::now();
+    }
+    void stop() {
+        duration += std::chrono::steady_clock::now() - startTime;
+        const auto now = threadAllocations();
+        allocations.count += now.count - startAllocations.count;
+        allocations.bytes += now.bytes - startAllocations.bytes;
+    }
+};
+
+// Wall time, allocations and peak memory of the phases of a run, nested as
+// they were started. Phases must be timed on a single thread.
+class TimeReport {
+  public:
+    struct Phase {
+        std::string name;
+        unsigned depth;
+        // Since the report was created.
+        std::chrono::nanoseconds start;
+        std::chrono::nanoseconds duration;
+        AllocationCounts allocations;
+        // The process's high-water mark when the phase ended.
+        long peakResidentKiB;
+    };
+
+    // Times a phase from its creation until it is destroyed. With a null
+    // report it does nothing, so callers need not check.
+    class Scope {
+        TimeReport *report;
+        size_t index = 0;
+        AllocationCounts startAllocations;
+        AllocationCounts startBookkeeping;
+
+      public:
+        Scope(TimeReport *report_, std::string_view name);
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope();
+    };
+
+  private:
+    std::chrono::steady_clock::time_point created =
+        std::chrono::steady_clock::now();
+    AllocationCounts createdAllocations = threadAllocations();
+    std::vector<Phase> phases;
+    unsigned depth = 0;
+    // Allocations made by the report itself, left out of every phase.
+    AllocationCounts bookkeeping;
+
+    void addPhase(Phase phase);
+
+  public:
+    // Adds the total of an accumulated phase as a child of the current one,
+    // placed at the current time.
+    void add(std::string_view name, const PhaseAccumulator &accumulator);
+
+    [[nodiscard]] const std::vector<Phase> &getPhases() const {
+        return phases;
+    }
+
+    // A table with a row per phase, children indented below their parent,
+    // and a total since the report was created.
+    void print(std::ostream &os) const;
+    // The phases as Chrome trace-event JSON, for chrome://tracing or
+    // Perfetto.
+    void writeChromeTrace(std::ostream &os) const;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "util/WorkStealing.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class WorkQueue {
+  private:
+    std::mutex mutex;
+    std::deque<size_t> indices;
+
+  public:
+    void push(size_t index) { indices.push_back(index); }
+
+    // The owner takes from the front, thieves from the back.
+    std::optional<size_t> take() {
+        const std::lock_guard lock(mutex);
+        if (indices.empty()) {
+            return std::nullopt;
+        }
+        const auto index = indices.front();
+        indices.pop_front();
+        return index;
+    }
+    std::optional<size_t> steal() {
+        const std::lock_guard lock(mutex);
+        if (indices.empty()) {
+            return std::nullopt;
+        }
+        const auto index = indices.back();
+        indices.pop_back();
+        return index;
+    }
+};
+
+} // namespace
+
+void runWorkStealing(size_t count, unsigned threadCount,
+                     const std::function<void(size_t)> &task) {
+    const auto workers = static_cast<size_t>(
+        std::clamp<size_t>(threadCount, 1, std::max<size_t>(count, 1)));
+    if (workers == 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    // Deal the indices out round-robin so every queue starts with some of
+    // the early tasks.
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    for (size_t i = 0; i < workers; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < count; i++) {
+        queues[i % workers]->push(i);
+    }
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    const auto work = [&](size_t self) {
+        while (true) {
+            auto index = queues[self]->take();
+            for (size_t offset = 1; !index && offset < workers; offset++) {
+                index = queues[(self + offset) % workers]->steal();
+            }
+            if (!index) {
+                // Nothing is ever added, so every queue stays empty.
+                return;
+            }
+            try {
+                task(*index);
+            } catch (...) {
+                const std::lock_guard lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::jthread> threads;
+    for (size_t i = 1; i < workers; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    threads.clear();
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
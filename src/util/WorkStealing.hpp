@@ -0,0 +1,17 @@
+#ifndef WORK_STEALING_HPP
+#define WORK_STEALING_HPP
+
+#include <cstddef>
+#include <functional>
+
+// Runs task(0) to task(count - 1) on up to threadCount threads and returns
+// once all of them have finished. Each thread starts with an equal share of
+// the indices and takes them in order; once its own share is used up it
+// steals from the far end of another thread's share, so a few slow tasks do
+// not hold the others up. Tasks that should start early belong at low
+// indices. If a task throws, the remaining tasks still run and the first
+// exception is rethrown afterwards.
+void runWorkStealing(size_t count, unsigned threadCount,
+                     const std::function<void(size_t)> &task);
+
+#endif
@@ -1,16 +1,45 @@
 #include "util/serialize.hpp"
 
+#include <algorithm>
+#include <iterator>
 #include <limits>
 #include <stdexcept>
+#include <string>
+
+size_t StringTable::intern(const std::string &str) {
+    const auto [it, inserted] = indices.try_emplace(str, strings.size());
+    if (inserted) {
+        strings.push_back(str);
+    }
+    return it->second;
+}
 
 void Serializer::writeInteger(size_t value) {
-    os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    while (value >= 0x80) {
+        os.put(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    os.put(static_cast<char>(value));
 }
 void Serializer::writeSignedInteger(std::int64_t value) {
-    os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    while (true) {
+        const auto byte = static_cast<std::uint8_t>(value & 0x7f);
+        // Arithmetic shift, so negative values end in a run of sign bits.
+        value >>= 7;
+        const bool signBit = (byte & 0x40) != 0;
+        if ((value == 0 && !signBit) || (value == -1 && signBit)) {
+            os.put(static_cast<char>(byte));
+            return;
+        }
+        os.put(static_cast<char>(byte | 0x80));
+    }
 }
 void Serializer::writeOpcode(Opcode value) {
-    os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    os.put(static_cast<char>(value));
+}
+void Serializer::writeHeader() {
+    os << bytecodeMagic;
+    writeInteger(bytecodeVersion);
 }
 void Serializer::writeString(const std::string &str) {
     writeInteger(str.size());
@@ -22,39 +51,140 @@ void Serializer::writeStringVector(const std::vector<std::string> &vec) {
         writeString(str);
     }
 }
+void Serializer::writeSymbol(const std::string &str) {
+    if (strings == nullptr) {
+        throw std::logic_error("symbol written without a string table");
+    }
+    writeInteger(strings->intern(str));
+}
+void Serializer::writeSymbolVector(const std::vector<std::string> &vec) {
+    writeInteger(vec.size());
+    for (const auto &str : vec) {
+        writeSymbol(str);
+    }
+}
+void Serializer::writeKindVector(const std::vector<ValueKind> &vec) {
+    writeInteger(vec.size());
+    for (const auto kind : vec) {
+        os.put(static_cast<char>(kind));
+    }
+}
+
+Deserializer::Deserializer(std::ifstream &stream)
+    : storage(std::istreambuf_iterator<char>(stream),
+              std::istreambuf_iterator<char>()),
+      bytes(storage) {}
+
+std::string_view Deserializer::readBytes(size_t length) {
+    if (length > bytes.size() - position) {
+        throw std::out_of_range("unexpected end of bytecode");
+    }
+    const auto result = bytes.substr(position, length);
+    position += length;
+    return result;
+}
+
+void Deserializer::seek(size_t offset) {
+    if (offset > bytes.size()) {
+        throw std::out_of_range("bytecode offset out of range");
+    }
+    position = offset;
+}
 
 size_t Deserializer::readInteger() {
     size_t value = 0;
-    is.read(reinterpret_cast<char *>(&value), sizeof(value));
-    return value;
+    for (unsigned shift = 0;; shift += 7) {
+        const auto byte = static_cast<std::uint8_t>(readBytes(1).front());
+        const size_t bits = byte & 0x7f;
+        if (shift >= std::numeric_limits<size_t>::digits ||
+            (bits << shift) >> shift != bits) {
+            throw std::invalid_argument("integer too large in bytecode");
+        }
+        value |= bits << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
 }
 std::int64_t Deserializer::readSignedInteger() {
-    std::int64_t value = 0;
-    is.read(reinterpret_cast<char *>(&value), sizeof(value));
-    return value;
+    std::uint64_t value = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        if (shift >= 64) {
+            throw std::invalid_argument("integer too large in bytecode");
+        }
+        const auto byte = static_cast<std::uint8_t>(readBytes(1).front());
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            // Sign-extend from the last byte's sign bit.
+            if (shift + 7 < 64 && (byte & 0x40) != 0) {
+                value |= ~std::uint64_t{0} << (shift + 7);
+            }
+            return static_cast<std::int64_t>(value);
+        }
+    }
+}
+Opcode Deserializer::readOpcode() {
+    return static_cast<Opcode>(readBytes(1).front());
+}
+void Deserializer::readHeader() {
+    if (bytes.size() < bytecodeMagic.size() ||
+        readBytes(bytecodeMagic.size()) != bytecodeMagic) {
+        throw std::invalid_argument("not a MiniJava bytecode file");
+    }
+    const auto version = readInteger();
+    if (version != bytecodeVersion) {
+        throw std::invalid_argument("unsupported bytecode version " +
+                                    std::to_string(version));
+    }
 }
 std::string Deserializer::readString() {
     const auto length = readInteger();
-    std::string str(length, '\0');
-    if (length >
-        static_cast<size_t>(std::numeric_limits<std::streamsize>::max())) {
-        throw std::length_error("string length exceeds streamsize");
-    }
-    is.read(str.data(), static_cast<std::streamsize>(length));
-    return str;
+    return std::string(readBytes(length));
 }
 std::vector<std::string> Deserializer::readStringVector() {
     const auto length = readInteger();
     std::vector<std::string> vec;
-    vec.reserve(length);
+    vec.reserve(std::min(length, bytes.size() - position));
     for (size_t i = 0; i < length; i++) {
         vec.emplace_back(readString());
     }
     return vec;
 }
-
-Opcode Deserializer::readOpcode() {
-    Opcode value = Opcode::ADD;
-    is.read(reinterpret_cast<char *>(&value), sizeof(value));
-    return value;
+void Deserializer::readStringTable() {
+    const auto length = readInteger();
+    strings.clear();
+    strings.reserve(std::min(length, bytes.size() - position));
+    for (size_t i = 0; i < length; i++) {
+        strings.push_back(readBytes(readInteger()));
+    }
+}
+std::string_view Deserializer::readSymbol() {
+    const auto index = readInteger();
+    if (index >= strings.size()) {
+        throw std::out_of_range("string index out of range in bytecode");
+    }
+    return strings[index];
+}
+std::vector<std::string_view> Deserializer::readSymbolVector() {
+    const auto length = readInteger();
+    std::vector<std::string_view> vec;
+    vec.reserve(std::min(length, bytes.size() - position));
+    for (size_t i = 0; i < length; i++) {
+        vec.push_back(readSymbol());
+    }
+    return vec;
+}
+std::vector<ValueKind> Deserializer::readKindVector() {
+    const auto length = readInteger();
+    const auto kinds = readBytes(length);
+    std::vector<ValueKind> vec;
+    vec.reserve(length);
+    for (const auto byte : kinds) {
+        const auto kind = static_cast<std::uint8_t>(byte);
+        if (kind > static_cast<std::uint8_t>(ValueKind::Array)) {
+            throw std::invalid_argument("invalid value kind");
+        }
+        vec.push_back(static_cast<ValueKind>(kind));
+    }
+    return vec;
 }
@@ -3,37 +3,87 @@
 
 #include <cstdint>
 #include <fstream>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "bytecode/Opcode.hpp"
+#include "bytecode/ValueKind.hpp"
 
+// Every bytecode file starts with this magic number and format version.
+inline constexpr std::string_view bytecodeMagic = "MJBC";
+inline constexpr size_t bytecodeVersion = 3;
+
+// Strings that a program refers to by index. Each distinct string is stored
+// once, in the string table at the start of the file.
+class StringTable {
+    std::unordered_map<std::string, size_t> indices;
+    std::vector<std::string> strings;
+
+  public:
+    size_t intern(const std::string &str);
+    [[nodiscard]] const auto &getStrings() const { return strings; }
+};
+
+// Integers are written as LEB128, signed ones as signed LEB128, so small
+// values take a single byte.
 class Serializer {
   private:
-    std::ofstream os;
+    std::ostream &os;
+    StringTable *strings;
 
   public:
-    explicit Serializer(std::ofstream &stream) : os(std::move(stream)) {}
+    explicit Serializer(std::ostream &stream, StringTable *strings_ = nullptr)
+        : os(stream), strings(strings_) {}
 
     void writeInteger(size_t value);
     void writeSignedInteger(std::int64_t value);
     void writeOpcode(Opcode value);
+    void writeHeader();
     void writeString(const std::string &str);
     void writeStringVector(const std::vector<std::string> &vec);
+    // A reference into the string table.
+    void writeSymbol(const std::string &str);
+    void writeSymbolVector(const std::vector<std::string> &vec);
+    void writeKindVector(const std::vector<ValueKind> &vec);
 };
 
+// Reads from the whole program held in memory. Reading past the end, or an
+// integer or string reference that does not fit, throws. Symbols are views
+// into the bytes being read, so they stay valid only as long as those bytes:
+// the caller's buffer, or this deserializer's copy of a stream.
 class Deserializer {
   private:
-    std::ifstream is;
+    std::string storage;
+    std::string_view bytes;
+    size_t position = 0;
+    std::vector<std::string_view> strings;
+
+    [[nodiscard]] std::string_view readBytes(size_t length);
 
   public:
-    explicit Deserializer(std::ifstream &stream) : is(std::move(stream)) {}
+    explicit Deserializer(std::ifstream &stream);
+    explicit Deserializer(std::string_view bytes_) : bytes(bytes_) {}
+    Deserializer(const Deserializer &) = delete;
+    Deserializer &operator=(const Deserializer &) = delete;
+
+    [[nodiscard]] size_t tell() const { return position; }
+    void seek(size_t offset);
 
     size_t readInteger();
     std::int64_t readSignedInteger();
     Opcode readOpcode();
+    // Checks the magic number and version.
+    void readHeader();
     std::string readString();
     std::vector<std::string> readStringVector();
+    // Reads the string table that later symbols refer to.
+    void readStringTable();
+    std::string_view readSymbol();
+    std::vector<std::string_view> readSymbolVector();
+    std::vector<ValueKind> readKindVector();
 };
 
 #endif
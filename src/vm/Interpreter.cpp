@@ -0,0 +1,3590 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <iomanip>
+#include <ios>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "vm/Interpreter.hpp"
+
+#include "bytecode/BytecodeInstruction.hpp"
+#include "bytecode/BytecodeMethod.hpp"
+#include "bytecode/BytecodeProgram.hpp"
+#include "bytecode/Opcode.hpp"
+#include "bytecode/ValueKind.hpp"
+#include "util/Json.hpp"
+#include "util/PerfCounters.hpp"
+#include "util/TimeReport.hpp"
+#include "util/serialize.hpp"
+
+#if MINIJAVA_VM_JIT
+#include <cstring>
+#endif
+#if __has_include(<sys/mman.h>)
+#define MINIJAVA_VM_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define MINIJAVA_VM_MMAP 0
+#endif
+#if MINIJAVA_VM_PROFILER && __has_include(<sys/time.h>)
+#define MINIJAVA_VM_SAMPLER 1
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <sys/time.h>
+#else
+#define MINIJAVA_VM_SAMPLER 0
+#endif
+
+// Everything but the entry points declared in vm/Interpreter.hpp is private
+// to this file; names like Method and Program are taken elsewhere in the
+// library.
+namespace {
+
+struct Method;
+
+// Names in a loaded program (in instructions, class layouts and method
+// variables) are views into its BytecodeImage, which the Program keeps alive.
+struct Instruction {
+    Opcode op;
+    std::int64_t argNumber;
+    std::string_view argString;
+    // Inline cache of a CALL: the method argString names, looked up the
+    // first time the call site runs so later calls skip the name lookup.
+    mutable const Method *callee = nullptr;
+    Instruction(Opcode op_, std::int64_t argNum_, std::string_view argStr_)
+        : op(op_), argNumber(argNum_), argString(argStr_) {};
+};
+
+using Value = std::int64_t;
+
+// Field layout of a class as computed by the compiler. Objects of the class
+// store field i at index i of their field array.
+struct ClassLayout {
+    std::string_view name;
+    std::vector<std::string_view> fields;
+    std::vector<ValueKind> fieldKinds;
+};
+
+#if MINIJAVA_VM_THREADED_DISPATCH
+// Pre-decoded form of an instruction for the computed-goto interpreter loop:
+// the address of its handler plus its integer operand.
+struct ThreadedInstruction {
+    const void *handler;
+    std::int64_t operand;
+};
+#endif
+
+#if MINIJAVA_VM_JIT
+class VM;
+
+// State shared between the interpreter and compiled code: the next free
+// operand stack slot, the locals of the running frame and the VM itself.
+struct JitFrame {
+    Value *sp;
+    Value *locals;
+    VM *vm;
+};
+
+// Machine code for one method in its own mapping, written while the mapping
+// is read-write and then made read-execute. Running it from instruction
+// offset pc returns the offset the interpreter has to continue at.
+class NativeCode {
+    void *memory;
+    size_t size;
+    // The offsets worth entering the code at; see nativeEntryPoints.
+    std::vector<bool> entryPoints;
+
+    NativeCode(void *memory_, size_t size_, std::vector<bool> entryPoints_)
+        : memory(memory_), size(size_), entryPoints(std::move(entryPoints_)) {}
+
+  public:
+    using Entry = std::int64_t (*)(JitFrame *frame, std::int64_t pc);
+
+    [[nodiscard]] static std::shared_ptr<const NativeCode>
+    create(const std::vector<std::uint8_t> &bytes,
+           std::vector<bool> entryPoints) {
+        const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const auto size = (bytes.size() + pageSize - 1) / pageSize * pageSize;
+        auto *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return nullptr;
+        }
+        std::memcpy(memory, bytes.data(), bytes.size());
+        if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+            munmap(memory, size);
+            return nullptr;
+        }
+        return std::shared_ptr<const NativeCode>(
+            new NativeCode(memory, size, std::move(entryPoints)));
+    }
+    NativeCode(const NativeCode &) = delete;
+    NativeCode &operator=(const NativeCode &) = delete;
+    ~NativeCode() { munmap(memory, size); }
+
+    [[nodiscard]] bool entersAt(size_t pc) const {
+        return pc < entryPoints.size() && entryPoints[pc];
+    }
+
+    [[nodiscard]] std::int64_t run(JitFrame &frame, std::int64_t pc) const {
+        return reinterpret_cast<Entry>(memory)(&frame, pc);
+    }
+};
+
+// Per-method JIT tier state. Calls into the method and backward jumps taken
+// inside it count towards hotness; failed is set if compilation was tried
+// and did not produce code.
+struct JitState {
+    std::uint32_t hotness = 0;
+    bool failed = false;
+    std::shared_ptr<const NativeCode> code;
+};
+#endif
+
+#if MINIJAVA_VM_PROFILER
+// What --profile counts for a method: how often each of its instructions
+// ran, how often it was called, and how many instructions ran while it was
+// on the frame stack, itself and its callees included. Recursive calls are
+// counted towards the inclusive total once, from the outermost activation.
+struct MethodProfile {
+    std::vector<std::uint64_t> counts;
+    std::uint64_t calls = 0;
+    std::uint64_t inclusive = 0;
+    size_t activations = 0;
+};
+#endif
+
+struct Block {
+    std::vector<Instruction> instructions;
+};
+
+struct Method {
+    std::vector<std::string_view> localVariables;
+    std::vector<ValueKind> localKinds;
+    MethodSignature signature;
+    std::int64_t classId = 0;
+    // All blocks of the method laid out back to back. Jump instructions carry
+    // the resolved offset of their target block in argNumber.
+    std::vector<Instruction> code;
+    std::vector<std::pair<std::string_view, size_t>> labels;
+    size_t entry = 0;
+    // Kinds of the operand stack entries that stay live across each NEW,
+    // NEW_ARRAY and CALL, keyed by the offset of the instruction. The garbage
+    // collector uses them to tell references from integers on the stack.
+    std::unordered_map<size_t, std::vector<ValueKind>> stackMaps;
+    // Deepest the operand stack gets above the method's entry stack, which
+    // includes its arguments and receiver.
+    size_t maxStackDepth = 0;
+    // Set by the verifier when no path through the method needs the
+    // interpreter's structural runtime checks.
+    bool verified = false;
+    // Where the method's body lies in the code section of the bytecode. The
+    // directory gives every method's class and signature up front; the body
+    // is only decoded, linked and verified when the method is first called.
+    size_t codeOffset = 0;
+    size_t codeSize = 0;
+    // Where the body comes from instead when the program was handed over in
+    // memory rather than as bytecode.
+    const BytecodeMethod *source = nullptr;
+    bool decoded = false;
+#if MINIJAVA_VM_THREADED_DISPATCH
+    std::vector<ThreadedInstruction> threadedCode;
+#endif
+#if MINIJAVA_VM_JIT
+    // Filled in while the program runs, through the const Method of a frame.
+    mutable JitState jit;
+#endif
+#if MINIJAVA_VM_PROFILER
+    mutable MethodProfile profile;
+#endif
+
+    void print() const {
+        for (size_t i = 0; i < labels.size(); i++) {
+            const auto &[name, begin] = labels[i];
+            const auto end =
+                i + 1 < labels.size() ? labels[i + 1].second : code.size();
+            std::cout << "\tblock " << name << "\n";
+            for (size_t pc = begin; pc < end; pc++) {
+                printInstruction(code[pc]);
+            }
+        }
+    };
+
+  private:
+    static void printInstruction(const Instruction &instr) {
+        const auto opcodeIndex =
+            static_cast<size_t>(static_cast<std::uint8_t>(instr.op));
+        if (opcodeIndex >= mnemonics.size()) {
+            throw std::invalid_argument("invalid opcode in block print");
+        }
+        std::cout << "\t\t" << mnemonics[opcodeIndex] << "\t";
+        if (instr.argString.empty()) {
+            std::cout << instr.argNumber << "\n";
+        } else {
+            std::cout << instr.argString << "\n";
+        }
+    }
+};
+
+// Lays out the blocks of a method in serialized order into one instruction
+// array and rewrites every JMP/CJMP target from a block name into an offset.
+// Jumps to blocks that were never emitted are linked to an offset of -1 and
+// only fail if they are taken. Name-based LOAD/STORE is rewritten to its slot
+// or field form and NEW is resolved to a class id. Slot and field operands
+// are bounds-checked here so the interpreter can index frames and objects
+// directly.
+[[nodiscard]] Method
+linkMethod(const std::string &methodName,
+           std::vector<std::string_view> localVariables,
+           std::vector<ValueKind> localKinds, MethodSignature signature,
+           std::int64_t classId, const std::vector<ClassLayout> &classes,
+           std::vector<std::pair<std::string_view, Block>> blocks) {
+    if (classId < 0 || static_cast<size_t>(classId) >= classes.size()) {
+        throw std::out_of_range("class id " + std::to_string(classId) +
+                                " out of range in method " + methodName);
+    }
+    if (localKinds.size() != localVariables.size()) {
+        throw std::invalid_argument("variable kinds do not match variables "
+                                    "in method " +
+                                    methodName);
+    }
+    const auto &owner = classes[static_cast<size_t>(classId)];
+
+    Method method;
+    method.localVariables = std::move(localVariables);
+    method.localKinds = std::move(localKinds);
+    method.signature = std::move(signature);
+    method.classId = classId;
+
+    size_t codeSize = 0;
+    for (const auto &[name, block] : blocks) {
+        codeSize += block.instructions.size();
+    }
+    method.code.reserve(codeSize);
+
+    std::unordered_map<std::string_view, size_t> offsets;
+    for (auto &[name, block] : blocks) {
+        offsets.emplace(name, method.code.size());
+        method.labels.emplace_back(name, method.code.size());
+        std::move(block.instructions.begin(), block.instructions.end(),
+                  std::back_inserter(method.code));
+    }
+
+    const auto entry = offsets.find(methodName);
+    if (entry == offsets.end()) {
+        throw std::invalid_argument("entry block of method " + methodName +
+                                    " not found");
+    }
+    method.entry = entry->second;
+
+    std::unordered_map<std::string_view, std::int64_t> slots;
+    for (size_t i = 0; i < method.localVariables.size(); i++) {
+        slots.emplace(method.localVariables[i], static_cast<std::int64_t>(i));
+    }
+    std::unordered_map<std::string_view, std::int64_t> fieldSlots;
+    for (size_t i = 0; i < owner.fields.size(); i++) {
+        fieldSlots.emplace(owner.fields[i], static_cast<std::int64_t>(i));
+    }
+    std::unordered_map<std::string_view, std::int64_t> classIds;
+    for (size_t i = 0; i < classes.size(); i++) {
+        classIds.emplace(classes[i].name, static_cast<std::int64_t>(i));
+    }
+    const auto slotCount =
+        static_cast<std::int64_t>(method.localVariables.size());
+    const auto fieldCount = static_cast<std::int64_t>(owner.fields.size());
+    const auto hasReceiver =
+        !method.localVariables.empty() && method.localVariables[0] == "this";
+    const auto checkFieldAccess = [&](const Instruction &instruction) {
+        if (!hasReceiver) {
+            throw std::invalid_argument("field access without this in method " +
+                                        methodName);
+        }
+        if (instruction.argNumber < 0 || instruction.argNumber >= fieldCount) {
+            throw std::out_of_range("field " +
+                                    std::to_string(instruction.argNumber) +
+                                    " out of range in method " + methodName);
+        }
+    };
+
+    for (auto &instruction : method.code) {
+        switch (instruction.op) {
+        case Opcode::JMP:
+        case Opcode::CJMP: {
+            const auto target = offsets.find(instruction.argString);
+            instruction.argNumber =
+                target != offsets.end()
+                    ? static_cast<std::int64_t>(target->second)
+                    : -1;
+            break;
+        }
+        case Opcode::NEW: {
+            const auto id = classIds.find(instruction.argString);
+            if (id == classIds.end()) {
+                throw std::invalid_argument(
+                    "class " + std::string(instruction.argString) +
+                    " not found");
+            }
+            instruction.argNumber = id->second;
+            break;
+        }
+        case Opcode::LOAD:
+        case Opcode::STORE: {
+            const auto isLoad = instruction.op == Opcode::LOAD;
+            if (const auto slot = slots.find(instruction.argString);
+                slot != slots.end()) {
+                instruction.op =
+                    isLoad ? Opcode::LOAD_LOCAL : Opcode::STORE_LOCAL;
+                instruction.argNumber = slot->second;
+            } else if (const auto field = fieldSlots.find(instruction.argString);
+                       field != fieldSlots.end()) {
+                instruction.op = isLoad ? Opcode::GETFIELD : Opcode::PUTFIELD;
+                instruction.argNumber = field->second;
+                checkFieldAccess(instruction);
+            } else {
+                throw std::invalid_argument(
+                    "variable " + std::string(instruction.argString) +
+                    " not found in method " + methodName);
+            }
+            break;
+        }
+        case Opcode::GETFIELD:
+        case Opcode::PUTFIELD: {
+            checkFieldAccess(instruction);
+            break;
+        }
+        case Opcode::LOAD_LOCAL:
+        case Opcode::STORE_LOCAL: {
+            if (instruction.argNumber < 0 ||
+                instruction.argNumber >= slotCount) {
+                throw std::out_of_range("local slot " +
+                                        std::to_string(instruction.argNumber) +
+                                        " out of range in method " +
+                                        methodName);
+            }
+            break;
+        }
+        default: {
+            break;
+        }
+        }
+    }
+    return method;
+}
+
+// A call frame. Frames are kept contiguously in VM::frames and refer to the
+// shared, immutable code of their method; their locals live in VM::locals
+// starting at localsBase.
+struct Frame {
+    const Method *method = nullptr;
+    size_t pc = 0;
+    size_t localsBase = 0;
+};
+
+// The operand stack shared by all frames, in one contiguous buffer. The
+// interpreter keeps its own stack pointer and caches the top value in a
+// local while it runs, writing both back here before anything else looks at
+// the stack. One scratch slot below the bottom lets it spill the cached top
+// without checking whether the stack is empty.
+class OperandStack {
+    static constexpr size_t initialCapacity = 1024;
+
+    std::vector<Value> storage = std::vector<Value>(1 + initialCapacity);
+    size_t depth = 0;
+
+  public:
+    [[nodiscard]] Value *data() { return storage.data() + 1; }
+    [[nodiscard]] const Value *data() const { return storage.data() + 1; }
+    [[nodiscard]] size_t size() const { return depth; }
+    [[nodiscard]] size_t capacity() const { return storage.size() - 1; }
+    [[nodiscard]] bool empty() const { return depth == 0; }
+    [[nodiscard]] Value operator[](size_t index) const { return data()[index]; }
+    [[nodiscard]] Value back() const { return data()[depth - 1]; }
+
+    // Makes room for count more values without moving the stack again.
+    void reserve(size_t count) {
+        if (capacity() - depth < count) {
+            storage.resize(1 + 2 * (depth + count));
+        }
+    }
+    // Values added by growing the stack are left for the caller to write.
+    void resize(size_t size) {
+        if (size > depth) {
+            reserve(size - depth);
+        }
+        depth = size;
+    }
+    void push_back(Value value) {
+        reserve(1);
+        data()[depth++] = value;
+    }
+    void pop_back() { depth--; }
+};
+
+// The bytes of a bytecode file. Where the platform allows, the file is
+// mapped into memory rather than read, so loading a program does not copy
+// it.
+class BytecodeImage {
+    std::string_view bytes;
+    std::string buffer;
+#if MINIJAVA_VM_MMAP
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+#endif
+
+  public:
+    BytecodeImage() = default;
+    BytecodeImage(const BytecodeImage &) = delete;
+    BytecodeImage &operator=(const BytecodeImage &) = delete;
+    ~BytecodeImage() {
+#if MINIJAVA_VM_MMAP
+        if (mapping != nullptr) {
+            munmap(mapping, mappingSize);
+        }
+#endif
+    }
+
+    // Returns nullptr if the file cannot be opened.
+    [[nodiscard]] static std::shared_ptr<const BytecodeImage>
+    open(const std::string &filename);
+    [[nodiscard]] std::string_view view() const { return bytes; }
+};
+
+std::shared_ptr<const BytecodeImage>
+BytecodeImage::open(const std::string &filename) {
+    auto image = std::make_shared<BytecodeImage>();
+#if MINIJAVA_VM_MMAP
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat status {};
+    if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode) &&
+        status.st_size > 0) {
+        const auto size = static_cast<size_t>(status.st_size);
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            image->mapping = mapping;
+            image->mappingSize = size;
+            image->bytes = {static_cast<const char *>(mapping), size};
+            close(fd);
+            return image;
+        }
+    }
+    close(fd);
+#endif
+    // Empty files and files that cannot be mapped are read instead.
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+    image->buffer.assign(std::istreambuf_iterator<char>(file),
+                         std::istreambuf_iterator<char>());
+    image->bytes = image->buffer;
+    return image;
+}
+
+// How much of the program has been decoded so far, and how long decoding
+// took. Programs handed over in memory have no code bytes to count.
+struct LoadStats {
+    size_t methods = 0;
+    size_t methodsDecoded = 0;
+    size_t codeBytes = 0;
+    size_t codeBytesDecoded = 0;
+    size_t instructionsDecoded = 0;
+    std::chrono::steady_clock::duration decodeTime{};
+};
+
+class Program {
+    // Exactly one of image and source is set.
+    std::shared_ptr<const BytecodeImage> image;
+    const BytecodeProgram *source = nullptr;
+    // Reads method bodies out of the image's code section on demand.
+    std::shared_ptr<Deserializer> reader;
+    size_t codeStart = 0;
+    // Where the optional line table starts: just past the last method body.
+    size_t linesStart = 0;
+    std::vector<ClassLayout> classes;
+    std::string_view mainMethodName;
+    Method mainMethod;
+    std::unordered_map<std::string_view, Method> methods;
+    LoadStats loadStats;
+
+    void decode(std::string_view name, Method &method);
+
+  public:
+    const auto &getMain() const { return mainMethod; }
+    // Finds a method without decoding it; enough to check its signature.
+    [[nodiscard]] const Method *findMethod(std::string_view name) const {
+        const auto &it = methods.find(name);
+        return it != methods.end() ? &it->second : nullptr;
+    }
+    // Finds a method and decodes it if this is the first time it is needed.
+    [[nodiscard]] Method *loadMethod(std::string_view name) {
+        const auto &it = methods.find(name);
+        if (it == methods.end()) {
+            return nullptr;
+        }
+        if (!it->second.decoded) {
+            decode(it->first, it->second);
+        }
+        return &it->second;
+    }
+    // Methods come from the method directory undecoded; main is decoded
+    // straight away.
+    Program(std::shared_ptr<const BytecodeImage> image_,
+            std::shared_ptr<Deserializer> reader_, size_t codeStart_,
+            std::vector<ClassLayout> classes_, std::string_view mainMethodName_,
+            Method mainMethod_,
+            std::unordered_map<std::string_view, Method> methods_)
+        : image(std::move(image_)), reader(std::move(reader_)),
+          codeStart(codeStart_), classes(std::move(classes_)),
+          mainMethodName(mainMethodName_), mainMethod(std::move(mainMethod_)),
+          methods(std::move(methods_)) {
+        loadStats.methods = methods.size() + 1;
+        loadStats.codeBytes = mainMethod.codeSize;
+        size_t codeEnd = mainMethod.codeOffset + mainMethod.codeSize;
+        for (const auto &[name, method] : methods) {
+            loadStats.codeBytes += method.codeSize;
+            codeEnd = std::max(codeEnd, method.codeOffset + method.codeSize);
+        }
+        linesStart = codeStart + codeEnd;
+        decode(mainMethodName, mainMethod);
+    };
+    // The same for a program handed over in memory, whose names the program
+    // keeps pointing into.
+    Program(const BytecodeProgram &source_, std::vector<ClassLayout> classes_,
+            std::string_view mainMethodName_, Method mainMethod_,
+            std::unordered_map<std::string_view, Method> methods_)
+        : source(&source_), classes(std::move(classes_)),
+          mainMethodName(mainMethodName_), mainMethod(std::move(mainMethod_)),
+          methods(std::move(methods_)) {
+        loadStats.methods = methods.size() + 1;
+        decode(mainMethodName, mainMethod);
+    };
+
+    // Visits the methods decoded so far.
+    template <typename Function> void forEachMethod(Function &&function) {
+        function(mainMethod);
+        for (auto &[name, method] : methods) {
+            if (method.decoded) {
+                function(method);
+            }
+        }
+    }
+
+    // Visits the methods decoded so far with their names.
+    template <typename Function>
+    void forEachNamedMethod(Function &&function) const {
+        function(mainMethodName, mainMethod);
+        for (const auto &[name, method] : methods) {
+            if (method.decoded) {
+                function(name, method);
+            }
+        }
+    }
+
+#if MINIJAVA_VM_PROFILER
+    // The source line of each instruction of every method in the line
+    // table, by method name. Lines are only used for reports, so a program
+    // whose line table is missing or unreadable just has none.
+    [[nodiscard]] std::unordered_map<std::string_view, std::vector<int>>
+    readLines() const;
+#endif
+
+    [[nodiscard]] const LoadStats &getLoadStats() const { return loadStats; }
+    std::string getMainMethodName() const {
+        return std::string(mainMethodName);
+    }
+    // Class ids are validated when methods are linked.
+    [[nodiscard]] const ClassLayout &getClass(std::int64_t classId) const {
+        return classes[static_cast<size_t>(classId)];
+    }
+};
+
+// Verifies a method by following its operand stack from the entry, and
+// records, for each allocation and call site, the kinds of the entries below
+// the operands the instruction consumes. Every method but main starts with
+// its arguments and receiver on the stack, pushed by the caller and stored by
+// its entry block.
+//
+// A stack that underflows or differs between two paths into an instruction
+// is rejected outright. Paths that would fail at run time instead (unknown
+// callees, unresolved jumps, running off the end of the code, invalid
+// opcodes, returning from main) are not followed, and together with operands
+// of the wrong kind they leave the method unverified: it still runs, but only
+// with every runtime check in place.
+void verifyMethod(Method &method, const std::string &methodName,
+                  std::vector<ValueKind> entryStack, const Program &program) {
+    const auto &fieldKinds = program.getClass(method.classId).fieldKinds;
+    const auto isMain = &method == &program.getMain();
+    std::vector<std::optional<std::vector<ValueKind>>> states(
+        method.code.size());
+    std::vector<size_t> worklist;
+    bool verified = true;
+
+    const auto error = [&methodName](const std::string &message, size_t pc) {
+        return std::invalid_argument(message + " at offset " +
+                                     std::to_string(pc) + " in method " +
+                                     methodName);
+    };
+    const auto reach = [&](size_t target, const std::vector<ValueKind> &stack,
+                           size_t from) {
+        method.maxStackDepth = std::max(method.maxStackDepth, stack.size());
+        if (target >= states.size()) {
+            verified = false;
+            return;
+        }
+        if (!states[target].has_value()) {
+            states[target] = stack;
+            worklist.push_back(target);
+        } else if (*states[target] != stack) {
+            throw error("inconsistent operand stack", from);
+        }
+    };
+
+    reach(method.entry, entryStack, method.entry);
+    while (!worklist.empty()) {
+        const auto pc = worklist.back();
+        worklist.pop_back();
+        auto stack = *states[pc];
+        const auto &instruction = method.code[pc];
+        // Pops the operands of the instruction, which are expected to have
+        // the given kinds, deepest first.
+        const auto popKinds = [&](std::initializer_list<ValueKind> kinds) {
+            if (stack.size() < kinds.size()) {
+                throw error("operand stack underflow", pc);
+            }
+            const auto operands = stack.end() - static_cast<std::ptrdiff_t>(
+                                                    kinds.size());
+            verified = verified && std::equal(kinds.begin(), kinds.end(),
+                                              operands, stack.end());
+            stack.erase(operands, stack.end());
+        };
+        constexpr auto Integer = ValueKind::Integer;
+
+        switch (instruction.op) {
+        case Opcode::CONST: {
+            stack.push_back(Integer);
+            break;
+        }
+        case Opcode::LOAD_LOCAL: {
+            stack.push_back(
+                method.localKinds[static_cast<size_t>(instruction.argNumber)]);
+            break;
+        }
+        case Opcode::GETFIELD: {
+            stack.push_back(
+                fieldKinds[static_cast<size_t>(instruction.argNumber)]);
+            break;
+        }
+        case Opcode::STORE_LOCAL: {
+            const auto slot = static_cast<size_t>(instruction.argNumber);
+            popKinds({method.localKinds[slot]});
+            break;
+        }
+        case Opcode::PUTFIELD: {
+            popKinds({fieldKinds[static_cast<size_t>(instruction.argNumber)]});
+            break;
+        }
+        case Opcode::PRINT: {
+            popKinds({Integer});
+            break;
+        }
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MUL:
+        case Opcode::DIV:
+        case Opcode::LT:
+        case Opcode::GT:
+        case Opcode::EQ:
+        case Opcode::AND:
+        case Opcode::OR: {
+            popKinds({Integer, Integer});
+            stack.push_back(Integer);
+            break;
+        }
+        case Opcode::NOT: {
+            popKinds({Integer});
+            stack.push_back(Integer);
+            break;
+        }
+        case Opcode::ARRAY_LOAD: {
+            popKinds({ValueKind::Array, Integer});
+            stack.push_back(Integer);
+            break;
+        }
+        case Opcode::ARRAY_LENGTH: {
+            popKinds({ValueKind::Array});
+            stack.push_back(Integer);
+            break;
+        }
+        case Opcode::ARRAY_STORE: {
+            popKinds({ValueKind::Array, Integer, Integer});
+            break;
+        }
+        case Opcode::NEW: {
+            method.stackMaps.emplace(pc, stack);
+            stack.push_back(ValueKind::Object);
+            break;
+        }
+        case Opcode::NEW_ARRAY: {
+            popKinds({Integer});
+            method.stackMaps.emplace(pc, stack);
+            stack.push_back(ValueKind::Array);
+            break;
+        }
+        case Opcode::CALL: {
+            const auto *callee = program.findMethod(instruction.argString);
+            if (callee == nullptr) {
+                verified = false;
+                continue;
+            }
+            const auto &parameters = callee->signature.parameters;
+            if (stack.size() < parameters.size() + 1) {
+                throw error("operand stack underflow", pc);
+            }
+            const auto arguments = stack.end() - static_cast<std::ptrdiff_t>(
+                                                     parameters.size() + 1);
+            verified = verified &&
+                       std::equal(parameters.begin(), parameters.end(),
+                                  arguments, stack.end() - 1) &&
+                       stack.back() == ValueKind::Object;
+            stack.erase(arguments, stack.end());
+            method.stackMaps.emplace(pc, stack);
+            stack.push_back(callee->signature.result);
+            break;
+        }
+        case Opcode::JMP: {
+            if (instruction.argNumber < 0) {
+                verified = false;
+            } else {
+                reach(static_cast<size_t>(instruction.argNumber), stack, pc);
+            }
+            continue;
+        }
+        case Opcode::CJMP: {
+            popKinds({Integer});
+            if (instruction.argNumber < 0) {
+                verified = false;
+            } else {
+                reach(static_cast<size_t>(instruction.argNumber), stack, pc);
+            }
+            break;
+        }
+        case Opcode::RET: {
+            // The caller finds exactly the result where it left the
+            // arguments and receiver.
+            verified = verified && !isMain &&
+                       stack == std::vector{method.signature.result};
+            continue;
+        }
+        case Opcode::STOP: {
+            continue;
+        }
+        default: {
+            verified = false;
+            continue;
+        }
+        }
+        reach(pc + 1, stack, pc);
+    }
+    method.verified = verified;
+}
+
+#if MINIJAVA_VM_JIT
+// VM routines that compiled code calls for heap accesses. Each returns
+// nullptr (or a negative length) instead of throwing, and compiled code then
+// leaves the instruction to the interpreter, which reports the error.
+struct JitHelpers {
+    Value *(*arrayElement)(VM *vm, Value reference, Value index);
+    Value (*arrayLength)(VM *vm, Value reference);
+    Value *(*fieldAddress)(VM *vm, std::int64_t field);
+};
+
+// Just enough of an x86-64 assembler for the baseline JIT. Memory operands
+// are always [base + disp32].
+class X64Assembler {
+  public:
+    enum Register : std::uint8_t {
+        RAX = 0,
+        RCX = 1,
+        RDX = 2,
+        RBX = 3,
+        RSI = 6,
+        RDI = 7,
+        R12 = 12,
+        R13 = 13,
+        R14 = 14,
+        R15 = 15
+    };
+    enum Condition : std::uint8_t {
+        EQUAL = 0x4,
+        NOT_EQUAL = 0x5,
+        LESS = 0xC,
+        GREATER = 0xF
+    };
+    using Label = size_t;
+
+  private:
+    // A 32-bit field at `at` holding target minus base, or target relative
+    // to the end of the field if there is no base.
+    struct Fixup {
+        size_t at;
+        Label target;
+        std::optional<Label> base;
+    };
+
+    std::vector<std::uint8_t> bytes;
+    std::vector<std::optional<size_t>> labels;
+    std::vector<Fixup> fixups;
+
+    void byte(std::uint8_t value) { bytes.push_back(value); }
+    void int32(std::int32_t value) {
+        for (int i = 0; i < 4; i++) {
+            byte(static_cast<std::uint8_t>(static_cast<std::uint32_t>(value) >>
+                                           (8 * i)));
+        }
+    }
+    void int64(std::int64_t value) {
+        for (int i = 0; i < 8; i++) {
+            byte(static_cast<std::uint8_t>(static_cast<std::uint64_t>(value) >>
+                                           (8 * i)));
+        }
+    }
+    void rexW(std::uint8_t reg, std::uint8_t base) {
+        byte(static_cast<std::uint8_t>(0x48 | ((reg >> 3) << 2) | (base >> 3)));
+    }
+    void rel32(Label label) {
+        fixups.push_back({.at = bytes.size(), .target = label, .base = {}});
+        int32(0);
+    }
+    // REX.W, the opcode bytes, then a [base + disp32] operand; an r12 base
+    // needs a SIB byte.
+    void memory(std::initializer_list<std::uint8_t> opcode, std::uint8_t reg,
+                Register base, std::int32_t disp) {
+        rexW(reg, base);
+        for (const auto op : opcode) {
+            byte(op);
+        }
+        byte(static_cast<std::uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7)));
+        if ((base & 7) == 4) {
+            byte(0x24);
+        }
+        int32(disp);
+    }
+
+  public:
+    [[nodiscard]] Label newLabel() {
+        labels.emplace_back();
+        return labels.size() - 1;
+    }
+    void bind(Label label) { labels[label] = bytes.size(); }
+
+    void load(Register reg, Register base, std::int32_t disp) {
+        memory({0x8B}, reg, base, disp);
+    }
+    void store(Register base, std::int32_t disp, Register reg) {
+        memory({0x89}, reg, base, disp);
+    }
+    void storeImmediate(Register base, std::int32_t disp, std::int32_t value) {
+        memory({0xC7}, 0, base, disp);
+        int32(value);
+    }
+    void addToMemory(Register base, std::int32_t disp, Register reg) {
+        memory({0x01}, reg, base, disp);
+    }
+    void subtractFromMemory(Register base, std::int32_t disp, Register reg) {
+        memory({0x29}, reg, base, disp);
+    }
+    void add(Register reg, Register base, std::int32_t disp) {
+        memory({0x03}, reg, base, disp);
+    }
+    void multiply(Register reg, Register base, std::int32_t disp) {
+        memory({0x0F, 0xAF}, reg, base, disp);
+    }
+    void compare(Register reg, Register base, std::int32_t disp) {
+        memory({0x3B}, reg, base, disp);
+    }
+    void compareImmediate(Register base, std::int32_t disp, std::int8_t value) {
+        memory({0x83}, 7, base, disp);
+        byte(static_cast<std::uint8_t>(value));
+    }
+    // Signed rax / [base + disp], quotient in rax.
+    void divide(Register base, std::int32_t disp) {
+        rexW(0, 0);
+        byte(0x99); // cqo
+        memory({0xF7}, 7, base, disp);
+    }
+    void addImmediate(Register reg, std::int8_t value) {
+        rexW(0, reg);
+        byte(0x83);
+        byte(static_cast<std::uint8_t>(0xC0 | (reg & 7)));
+        byte(static_cast<std::uint8_t>(value));
+    }
+    void subtractImmediate(Register reg, std::int8_t value) {
+        rexW(0, reg);
+        byte(0x83);
+        byte(static_cast<std::uint8_t>(0xE8 | (reg & 7)));
+        byte(static_cast<std::uint8_t>(value));
+    }
+    void move(Register dst, Register src) {
+        rexW(src, dst);
+        byte(0x89);
+        byte(static_cast<std::uint8_t>(0xC0 | ((src & 7) << 3) | (dst & 7)));
+    }
+    void moveImmediate(Register reg, std::int64_t value) {
+        rexW(0, reg);
+        byte(static_cast<std::uint8_t>(0xB8 | (reg & 7)));
+        int64(value);
+    }
+    // mov eax, imm32, which zero-extends into rax.
+    void moveImmediateEax(std::uint32_t value) {
+        byte(0xB8);
+        int32(static_cast<std::int32_t>(value));
+    }
+    // rax = 1 if the condition holds for the last comparison, else 0.
+    void setRax(Condition condition) {
+        byte(0x0F);
+        byte(static_cast<std::uint8_t>(0x90 | condition));
+        byte(0xC0);
+        byte(0x0F); // movzx eax, al
+        byte(0xB6);
+        byte(0xC0);
+    }
+    void testRax() {
+        rexW(0, 0);
+        byte(0x85);
+        byte(0xC0);
+    }
+    void loadThroughRax(Register reg) {
+        rexW(reg, 0);
+        byte(0x8B);
+        byte(static_cast<std::uint8_t>((reg & 7) << 3));
+    }
+    void storeThroughRax(Register reg) {
+        rexW(reg, 0);
+        byte(0x89);
+        byte(static_cast<std::uint8_t>((reg & 7) << 3));
+    }
+    void call(std::uintptr_t function) {
+        moveImmediate(RAX, static_cast<std::int64_t>(function));
+        byte(0xFF);
+        byte(0xD0);
+    }
+    void push(Register reg) {
+        if (reg >= 8) {
+            byte(0x41);
+        }
+        byte(static_cast<std::uint8_t>(0x50 | (reg & 7)));
+    }
+    void pop(Register reg) {
+        if (reg >= 8) {
+            byte(0x41);
+        }
+        byte(static_cast<std::uint8_t>(0x58 | (reg & 7)));
+    }
+    void ret() { byte(0xC3); }
+    void jump(Label label) {
+        byte(0xE9);
+        rel32(label);
+    }
+    void jumpIf(Condition condition, Label label) {
+        byte(0x0F);
+        byte(static_cast<std::uint8_t>(0x80 | condition));
+        rel32(label);
+    }
+    // Jumps to the table entry indexed by rsi. Entries are int32 offsets of
+    // their target from the start of the table.
+    void jumpThroughTable(Label table) {
+        byte(0x48); // lea rcx, [rip + table]
+        byte(0x8D);
+        byte(0x0D);
+        rel32(table);
+        byte(0x48); // movsxd rax, dword [rcx + rsi * 4]
+        byte(0x63);
+        byte(0x04);
+        byte(0xB1);
+        byte(0x48); // add rax, rcx
+        byte(0x01);
+        byte(0xC8);
+        byte(0xFF); // jmp rax
+        byte(0xE0);
+    }
+    void tableEntry(Label table, Label target) {
+        fixups.push_back({.at = bytes.size(), .target = target, .base = table});
+        int32(0);
+    }
+    void align(size_t alignment) {
+        while (bytes.size() % alignment != 0) {
+            byte(0xCC);
+        }
+    }
+
+    // Resolves label references; nullopt if one was never bound.
+    [[nodiscard]] std::optional<std::vector<std::uint8_t>> finish() {
+        for (const auto &fixup : fixups) {
+            const auto target = labels[fixup.target];
+            const auto origin = fixup.base.has_value()
+                                    ? labels[*fixup.base]
+                                    : std::optional<size_t>{fixup.at + 4};
+            if (!target.has_value() || !origin.has_value()) {
+                return std::nullopt;
+            }
+            const auto value = static_cast<std::uint32_t>(
+                static_cast<std::int64_t>(*target) -
+                static_cast<std::int64_t>(*origin));
+            for (size_t i = 0; i < 4; i++) {
+                bytes[fixup.at + i] =
+                    static_cast<std::uint8_t>(value >> (8 * i));
+            }
+        }
+        return std::move(bytes);
+    }
+};
+
+// Whether compileNative translates the instruction, rather than leaving it to
+// the interpreter whenever it is reached. Must agree with its switch.
+bool runsNatively(const Instruction &instruction) {
+    switch (instruction.op) {
+    case Opcode::CONST:
+    case Opcode::LOAD_LOCAL:
+    case Opcode::STORE_LOCAL:
+    case Opcode::ADD:
+    case Opcode::SUB:
+    case Opcode::MUL:
+    case Opcode::DIV:
+    case Opcode::LT:
+    case Opcode::GT:
+    case Opcode::EQ:
+    case Opcode::AND:
+    case Opcode::OR:
+    case Opcode::NOT:
+    case Opcode::ARRAY_LOAD:
+    case Opcode::ARRAY_STORE:
+    case Opcode::ARRAY_LENGTH:
+    case Opcode::GETFIELD:
+    case Opcode::PUTFIELD:
+        return true;
+    case Opcode::JMP:
+    case Opcode::CJMP:
+        return instruction.argNumber >= 0;
+    default:
+        return false;
+    }
+}
+
+// Entering compiled code costs more than interpreting a few instructions:
+// the operand stack is grown, the jump table dispatched and registers saved.
+// It is only worth it where the code can run at least minimumNativeRun
+// instructions before it hands back to the interpreter; a method or loop
+// that calls or allocates every few instructions is better left interpreted.
+constexpr size_t minimumNativeRun = 16;
+
+// The offsets of method worth entering its compiled code at: those from
+// which some path through compiled instructions, going either way at
+// conditional jumps, is minimumNativeRun long. Loops that stay in compiled
+// code qualify however short they are.
+std::vector<bool> nativeEntryPoints(const Method &method) {
+    const auto size = method.code.size();
+    // Whether a path of the current length starts at each offset; running
+    // off the end is left to the interpreter.
+    std::vector<bool> runs(size + 1, false);
+    for (size_t pc = 0; pc < size; pc++) {
+        runs[pc] = runsNatively(method.code[pc]);
+    }
+    for (size_t length = 2; length <= minimumNativeRun; length++) {
+        std::vector<bool> longer(size + 1, false);
+        for (size_t pc = 0; pc < size; pc++) {
+            const auto &instruction = method.code[pc];
+            if (!runs[pc]) {
+                continue;
+            }
+            const auto target =
+                std::min(static_cast<size_t>(instruction.argNumber), size);
+            switch (instruction.op) {
+            case Opcode::JMP:
+                longer[pc] = runs[target];
+                break;
+            case Opcode::CJMP:
+                longer[pc] = runs[target] || runs[pc + 1];
+                break;
+            default:
+                longer[pc] = runs[pc + 1];
+                break;
+            }
+        }
+        runs = std::move(longer);
+    }
+    runs.resize(size);
+    return runs;
+}
+
+// Template-compiles a method: every instruction becomes a fixed machine code
+// sequence, and the operand stack and locals stay in memory exactly as the
+// interpreter keeps them, so the code can be entered and left at any
+// instruction offset. Instructions that need the interpreter (calls,
+// returns, allocation, printing and anything that would fail) leave the
+// compiled code at their own offset before touching the stack.
+//
+// Registers: rbx holds the JitFrame, r12 the next free stack slot, r13 the
+// frame's locals and r14 the VM passed to helpers.
+[[nodiscard]] std::shared_ptr<const NativeCode>
+compileNative(const Method &method, const JitHelpers &helpers) {
+    using enum X64Assembler::Register;
+    using enum X64Assembler::Condition;
+    constexpr std::int32_t slot = sizeof(Value);
+    if (method.code.size() >
+        static_cast<size_t>(std::numeric_limits<std::int32_t>::max() / slot)) {
+        return nullptr;
+    }
+
+    X64Assembler assembler;
+    const auto table = assembler.newLabel();
+    const auto epilogue = assembler.newLabel();
+    std::vector<X64Assembler::Label> instructionLabels;
+    for (size_t pc = 0; pc <= method.code.size(); pc++) {
+        instructionLabels.push_back(assembler.newLabel());
+    }
+    // Exit stubs hand an instruction offset back to the interpreter and are
+    // only emitted for instructions that use them.
+    std::vector<std::optional<X64Assembler::Label>> exitLabels(
+        method.code.size() + 1);
+    const auto exitLabel = [&](size_t pc) {
+        if (!exitLabels[pc].has_value()) {
+            exitLabels[pc] = assembler.newLabel();
+        }
+        return *exitLabels[pc];
+    };
+    const auto callHelper = [&assembler](auto *helper) {
+        assembler.move(RDI, R14);
+        assembler.call(reinterpret_cast<std::uintptr_t>(helper));
+    };
+    const auto local = [](std::int64_t index) {
+        return static_cast<std::int32_t>(index) * slot;
+    };
+
+    // r15 is only saved to keep the stack 16-byte aligned for helper calls.
+    assembler.push(RBX);
+    assembler.push(R12);
+    assembler.push(R13);
+    assembler.push(R14);
+    assembler.push(R15);
+    assembler.move(RBX, RDI);
+    assembler.load(R12, RBX, offsetof(JitFrame, sp));
+    assembler.load(R13, RBX, offsetof(JitFrame, locals));
+    assembler.load(R14, RBX, offsetof(JitFrame, vm));
+    assembler.jumpThroughTable(table);
+
+    for (size_t pc = 0; pc < method.code.size(); pc++) {
+        assembler.bind(instructionLabels[pc]);
+        const auto &instruction = method.code[pc];
+        const auto operand = instruction.argNumber;
+        switch (instruction.op) {
+        case Opcode::CONST: {
+            if (operand >= std::numeric_limits<std::int32_t>::min() &&
+                operand <= std::numeric_limits<std::int32_t>::max()) {
+                assembler.storeImmediate(R12, 0,
+                                         static_cast<std::int32_t>(operand));
+            } else {
+                assembler.moveImmediate(RAX, operand);
+                assembler.store(R12, 0, RAX);
+            }
+            assembler.addImmediate(R12, slot);
+            break;
+        }
+        case Opcode::LOAD_LOCAL: {
+            assembler.load(RAX, R13, local(operand));
+            assembler.store(R12, 0, RAX);
+            assembler.addImmediate(R12, slot);
+            break;
+        }
+        case Opcode::STORE_LOCAL: {
+            assembler.load(RAX, R12, -slot);
+            assembler.store(R13, local(operand), RAX);
+            assembler.subtractImmediate(R12, slot);
+            break;
+        }
+        case Opcode::ADD: {
+            assembler.load(RAX, R12, -slot);
+            assembler.addToMemory(R12, -2 * slot, RAX);
+            assembler.subtractImmediate(R12, slot);
+            break;
+        }
+        case Opcode::SUB: {
+            assembler.load(RAX, R12, -slot);
+            assembler.subtractFromMemory(R12, -2 * slot, RAX);
+            assembler.subtractImmediate(R12, slot);
+            break;
+        }
+        case Opcode::MUL: {
+            assembler.load(RAX, R12, -2 * slot);
+            assembler.multiply(RAX, R12, -slot);
+            assembler.store(R12, -2 * slot, RAX);
+            assembler.subtractImmediate(R12, slot);
+            break;
+        }
+        case Opcode::DIV: {
+            // idiv traps on a zero divisor and on INT64_MIN / -1, so both
+            // leave the instruction to the interpreter: it reports the
+            // first and wraps the second around.
+            assembler.compareImmediate(R12, -slot, 0);
+            assembler.jumpIf(EQUAL, exitLabel(pc));
+            assembler.compareImmediate(R12, -slot, -1);
+            assembler.jumpIf(EQUAL, exitLabel(pc));
+            assembler.load(RAX, R12, -2 * slot);
+            assembler.divide(R12, -slot);
+            assembler.store(R12, -2 * slot, RAX);
+            assembler.subtractImmediate(R12, slot);
+            break;
+        }
+        case Opcode::LT:
+        case Opcode::GT:
+        case Opcode::EQ: {
+            // The second operand is compared with the top of the stack, so LT
+            // is a signed less-than and GT a signed greater-than.
+            assembler.load(RAX, R12, -2 * slot);
+            assembler.compare(RAX, R12, -slot);
+            assembler.setRax(instruction.op == Opcode::EQ   ? EQUAL
+                             : instruction.op == Opcode::LT ? LESS
+                                                            : GREATER);
+            assembler.store(R12, -2 * slot, RAX);
+            assembler.subtractImmediate(R12, slot);
+            break;
+        }
+        case Opcode::AND:
+        case Opcode::OR: {
+            assembler.load(RAX, R12, -2 * slot);
+            if (instruction.op == Opcode::AND) {
+                assembler.multiply(RAX, R12, -slot);
+            } else {
+                assembler.add(RAX, R12, -slot);
+            }
+            assembler.testRax();
+            assembler.setRax(NOT_EQUAL);
+            assembler.store(R12, -2 * slot, RAX);
+            assembler.subtractImmediate(R12, slot);
+            break;
+        }
+        case Opcode::NOT: {
+            assembler.compareImmediate(R12, -slot, 0);
+            assembler.setRax(EQUAL);
+            assembler.store(R12, -slot, RAX);
+            break;
+        }
+        case Opcode::JMP: {
+            if (operand < 0) {
+                assembler.jump(exitLabel(pc));
+                break;
+            }
+            assembler.jump(instructionLabels[static_cast<size_t>(operand)]);
+            break;
+        }
+        case Opcode::CJMP: {
+            if (operand < 0) {
+                assembler.jump(exitLabel(pc));
+                break;
+            }
+            assembler.subtractImmediate(R12, slot);
+            assembler.compareImmediate(R12, 0, 0);
+            assembler.jumpIf(EQUAL,
+                             instructionLabels[static_cast<size_t>(operand)]);
+            break;
+        }
+        case Opcode::ARRAY_LOAD: {
+            assembler.load(RSI, R12, -2 * slot);
+            assembler.load(RDX, R12, -slot);
+            callHelper(helpers.arrayElement);
+            assembler.testRax();
+            assembler.jumpIf(EQUAL, exitLabel(pc));
+            assembler.loadThroughRax(RCX);
+            assembler.store(R12, -2 * slot, RCX);
+            assembler.subtractImmediate(R12, slot);
+            break;
+        }
+        case Opcode::ARRAY_STORE: {
+            assembler.load(RSI, R12, -3 * slot);
+            assembler.load(RDX, R12, -2 * slot);
+            callHelper(helpers.arrayElement);
+            assembler.testRax();
+            assembler.jumpIf(EQUAL, exitLabel(pc));
+            assembler.load(RCX, R12, -slot);
+            assembler.storeThroughRax(RCX);
+            assembler.subtractImmediate(R12, 3 * slot);
+            break;
+        }
+        case Opcode::ARRAY_LENGTH: {
+            assembler.load(RSI, R12, -slot);
+            callHelper(helpers.arrayLength);
+            assembler.testRax();
+            assembler.jumpIf(LESS, exitLabel(pc));
+            assembler.store(R12, -slot, RAX);
+            break;
+        }
+        case Opcode::GETFIELD:
+        case Opcode::PUTFIELD: {
+            assembler.moveImmediate(RSI, operand);
+            callHelper(helpers.fieldAddress);
+            assembler.testRax();
+            assembler.jumpIf(EQUAL, exitLabel(pc));
+            if (instruction.op == Opcode::GETFIELD) {
+                assembler.loadThroughRax(RCX);
+                assembler.store(R12, 0, RCX);
+                assembler.addImmediate(R12, slot);
+            } else {
+                assembler.load(RCX, R12, -slot);
+                assembler.storeThroughRax(RCX);
+                assembler.subtractImmediate(R12, slot);
+            }
+            break;
+        }
+        default: {
+            assembler.jump(exitLabel(pc));
+            break;
+        }
+        }
+    }
+    // Running off the end of the code is reported by the interpreter.
+    assembler.bind(instructionLabels[method.code.size()]);
+    assembler.jump(exitLabel(method.code.size()));
+
+    for (size_t pc = 0; pc < exitLabels.size(); pc++) {
+        if (exitLabels[pc].has_value()) {
+            assembler.bind(*exitLabels[pc]);
+            assembler.moveImmediateEax(static_cast<std::uint32_t>(pc));
+            assembler.jump(epilogue);
+        }
+    }
+
+    assembler.bind(epilogue);
+    assembler.store(RBX, offsetof(JitFrame, sp), R12);
+    assembler.pop(R15);
+    assembler.pop(R14);
+    assembler.pop(R13);
+    assembler.pop(R12);
+    assembler.pop(RBX);
+    assembler.ret();
+
+    assembler.align(4);
+    assembler.bind(table);
+    for (size_t pc = 0; pc < method.code.size(); pc++) {
+        assembler.tableEntry(table, instructionLabels[pc]);
+    }
+
+    const auto bytes = assembler.finish();
+    if (!bytes.has_value()) {
+        return nullptr;
+    }
+    return NativeCode::create(*bytes, nativeEntryPoints(method));
+}
+#endif
+
+struct GcStats {
+    size_t objectsAllocated = 0;
+    size_t arraysAllocated = 0;
+    size_t bytesAllocated = 0;
+    size_t collections = 0;
+    size_t objectsFreed = 0;
+    size_t arraysFreed = 0;
+    size_t bytesFreed = 0;
+    size_t peakBytes = 0;
+    std::chrono::nanoseconds pauseTime{0};
+};
+
+// Outcomes of the inline caches of CALL instructions. A call site misses
+// once, when it first runs and resolves its target, and hits afterwards.
+struct CallStats {
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+// What an instantiation of the interpreter loop records besides running the
+// program: nothing, the call stack whenever the sampling timer has ticked
+// (--sample), that and the number of instructions and the calls for
+// --perf-counters, or that and every instruction and call (--profile).
+enum class Instrumentation : std::uint8_t { None, Sampled, Measured, Counted };
+
+#if MINIJAVA_VM_SAMPLER
+// Ticks of the sampling timer that no sample has been taken for yet. The
+// SIGPROF handler only bumps this; the interpreter polls it at calls,
+// returns and jumps and records the call stack there, where the frame stack
+// is consistent. Ticks that land in compiled code are recorded when it next
+// hands control back.
+std::atomic<std::uint32_t> pendingSamples{0};
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+// Raises SIGPROF every interval of CPU time the process uses, for as long as
+// it exists. The timer belongs to the process, so only one can exist at a
+// time.
+class SampleTimer {
+    static inline std::atomic<bool> active{false};
+    struct sigaction previous{};
+
+    static void stop(const struct sigaction &action) {
+        const itimerval off{};
+        setitimer(ITIMER_PROF, &off, nullptr);
+        sigaction(SIGPROF, &action, nullptr);
+        active = false;
+    }
+
+  public:
+    explicit SampleTimer(std::chrono::microseconds interval) {
+        if (active.exchange(true)) {
+            throw std::runtime_error("another program is being sampled");
+        }
+        pendingSamples = 0;
+        struct sigaction action{};
+        action.sa_handler = [](int) {
+            pendingSamples.fetch_add(1, std::memory_order_relaxed);
+        };
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        if (sigaction(SIGPROF, &action, &previous) != 0) {
+            active = false;
+            throw std::system_error(errno, std::generic_category(),
+                                    "unable to handle SIGPROF");
+        }
+        itimerval timer{};
+        timer.it_interval.tv_sec = static_cast<time_t>(
+            interval.count() / std::micro::den);
+        timer.it_interval.tv_usec = static_cast<suseconds_t>(
+            interval.count() % std::micro::den);
+        timer.it_value = timer.it_interval;
+        if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+            const auto error = errno;
+            stop(previous);
+            throw std::system_error(error, std::generic_category(),
+                                    "unable to start the sampling timer");
+        }
+    }
+    SampleTimer(const SampleTimer &) = delete;
+    SampleTimer &operator=(const SampleTimer &) = delete;
+    ~SampleTimer() { stop(previous); }
+};
+#endif
+
+class VM {
+    // Freed object and array slots have live cleared and are reused by later
+    // allocations, so a reference is only valid while its slot is live.
+    struct ObjectInstance {
+        std::int64_t classId;
+        std::unique_ptr<Value[]> fields;
+        bool live = true;
+        bool marked = false;
+    };
+    struct ArrayInstance {
+        std::vector<Value> elements;
+        bool live = true;
+        bool marked = false;
+    };
+
+    static constexpr size_t initialFrameCapacity = 256;
+    static constexpr size_t initialLocalsCapacity = 4096;
+    static constexpr size_t initialCollectionThreshold = size_t{1} << 20;
+
+    OperandStack dataStack;
+    std::vector<Frame> frames;
+    std::vector<Value> locals;
+
+    Program program;
+    std::vector<ObjectInstance> objects;
+    std::vector<ArrayInstance> arrays;
+    std::vector<size_t> freeObjects;
+    std::vector<size_t> freeArrays;
+
+    HeapOptions heapOptions;
+    JitOptions jitOptions;
+    InterpreterOptions interpreterOptions;
+    // Where PRINT writes, and where errors that end the program are reported.
+    std::ostream *output;
+    std::ostream *errors;
+    size_t heapBytes = 0;
+    size_t nextCollection = initialCollectionThreshold;
+    GcStats gcStats;
+    CallStats callStats;
+#if MINIJAVA_VM_PROFILER
+    // The calls on the frame stack while profiling, each with the number of
+    // instructions that had run when it started.
+    struct ProfiledCall {
+        const Method *method;
+        std::uint64_t start;
+    };
+    std::vector<ProfiledCall> profiledCalls;
+    std::uint64_t instructionsExecuted = 0;
+
+    void enterProfiled(const Method &method) {
+        auto &profile = method.profile;
+        if (profile.counts.empty()) {
+            profile.counts.resize(method.code.size());
+        }
+        profile.calls++;
+        profile.activations++;
+        profiledCalls.push_back({&method, instructionsExecuted});
+    }
+    void leaveProfiled() {
+        const auto call = profiledCalls.back();
+        profiledCalls.pop_back();
+        auto &profile = call.method->profile;
+        if (--profile.activations == 0) {
+            profile.inclusive += instructionsExecuted - call.start;
+        }
+    }
+
+    // --perf-counters: the counters and what they read over the whole run.
+    // For per-method counts every call and return reads them and charges
+    // what was used since the last reading to the method that was running.
+    struct MethodCounters {
+        std::uint64_t calls = 0;
+        PerfCounts self;
+    };
+    PerfCounters *perfCounters = nullptr;
+    PerfCounts perfTotal;
+    PerfCounts lastPerfReading;
+    std::vector<const Method *> measuredCalls;
+    std::unordered_map<const Method *, MethodCounters> methodCounters;
+
+    void chargeMeasured(const PerfCounts &reading) {
+        methodCounters[measuredCalls.back()].self += reading - lastPerfReading;
+        lastPerfReading = reading;
+    }
+    void enterMeasured(const Method &method) {
+        chargeMeasured(perfCounters->read());
+        measuredCalls.push_back(&method);
+        methodCounters[&method].calls++;
+    }
+    void leaveMeasured() {
+        chargeMeasured(perfCounters->read());
+        measuredCalls.pop_back();
+    }
+    // Ends what run() started instrumenting, when the program stops or
+    // fails.
+    void finishInstrumentation();
+#endif
+
+#if MINIJAVA_VM_SAMPLER
+    // Call stacks, outermost method first, with the number of timer ticks
+    // that found the program in each.
+    std::map<std::vector<const Method *>, std::uint64_t> samples;
+
+    void takeSample() {
+        const auto ticks =
+            pendingSamples.exchange(0, std::memory_order_relaxed);
+        std::vector<const Method *> stack;
+        stack.reserve(frames.size());
+        for (const auto &frame : frames) {
+            stack.push_back(frame.method);
+        }
+        samples[std::move(stack)] += ticks;
+    }
+#endif
+
+#if MINIJAVA_VM_THREADED_DISPATCH
+    struct DispatchTable {
+        const void *const *handlers;
+        size_t size;
+        const void *invalidOpcode;
+        const void *unresolvedJump;
+        const void *endOfCode;
+    };
+    // The handlers of the interpreter loop that methods were last decoded
+    // for; each instantiation of execute has its own.
+    DispatchTable dispatchTable{};
+    static void decodeThreaded(Method &method, const DispatchTable &table);
+#endif
+
+    // Members templated on Checked come in two flavours. The checked one
+    // guards against everything a malformed program could do; the unchecked
+    // one is only used for verified programs and keeps just the checks that
+    // depend on run-time values, such as null references and array bounds.
+    template <bool Checked> const Instruction &step() {
+        auto &frame = frames.back();
+        if constexpr (Checked) {
+            if (frame.pc >= frame.method->code.size()) {
+                throw std::out_of_range("instruction pointer out of bounds");
+            }
+        }
+        return frame.method->code[frame.pc++];
+    }
+
+    template <bool Checked = true> void pushFrame(const Method &method) {
+        frames.push_back({.method = &method,
+                          .pc = method.entry,
+                          .localsBase = locals.size()});
+        locals.resize(locals.size() + method.localVariables.size(), 0);
+        if constexpr (!Checked) {
+            // Make room for the deepest the method's operand stack can get,
+            // so pushes inside it never need to check for room.
+            dataStack.reserve(method.maxStackDepth);
+        }
+    }
+    void popFrame() {
+        locals.resize(frames.back().localsBase);
+        frames.pop_back();
+    }
+
+    // Returns the method a CALL instruction invokes, or nullptr if there is
+    // no method by that name.
+    [[nodiscard]] const Method *resolveCall(const Instruction &callSite) {
+        if (callSite.callee != nullptr) {
+            callStats.hits++;
+            return callSite.callee;
+        }
+        callStats.misses++;
+        auto *callee = program.loadMethod(callSite.argString);
+#if MINIJAVA_VM_THREADED_DISPATCH
+        // A method decoded just now has no threaded code yet.
+        if (callee != nullptr && callee->threadedCode.empty()) {
+            decodeThreaded(*callee, dispatchTable);
+        }
+#endif
+        callSite.callee = callee;
+        return callee;
+    }
+
+    // Slots are validated when the method is linked.
+    [[nodiscard]] Value getLocal(std::int64_t slot) const {
+        return locals[frames.back().localsBase + static_cast<size_t>(slot)];
+    }
+    void setLocal(std::int64_t slot, Value value) {
+        locals[frames.back().localsBase + static_cast<size_t>(slot)] = value;
+    }
+    // Jumps to blocks that were never emitted are linked to -1.
+    template <bool Checked>
+    static std::int64_t jumpTarget(const Instruction &instruction) {
+        if constexpr (Checked) {
+            if (instruction.argNumber < 0) {
+                throw std::invalid_argument(
+                    "block " + std::string(instruction.argString) +
+                    " not found");
+            }
+        }
+        return instruction.argNumber;
+    }
+
+    // In a verified program a non-null reference of object or array kind
+    // always names a live slot: references only come from allocation, and
+    // the collector never frees anything still reachable.
+    template <bool Checked>
+    [[nodiscard]] ObjectInstance &getObjectByReference(Value reference) {
+        if constexpr (Checked) {
+            if (reference <= 0 ||
+                static_cast<size_t>(reference) > objects.size() ||
+                !objects[static_cast<size_t>(reference - 1)].live) {
+                throw std::invalid_argument("invalid object reference");
+            }
+        } else if (reference == 0) {
+            throw std::invalid_argument("invalid object reference");
+        }
+        return objects[static_cast<size_t>(reference - 1)];
+    }
+    [[nodiscard]] const ObjectInstance &
+    getObjectByReference(Value reference) const {
+        if (reference <= 0 || static_cast<size_t>(reference) > objects.size() ||
+            !objects[static_cast<size_t>(reference - 1)].live) {
+            throw std::invalid_argument("invalid object reference");
+        }
+        return objects[static_cast<size_t>(reference - 1)];
+    }
+
+    [[nodiscard]] ArrayInstance *findArray(Value reference) {
+        if (reference <= 0 || static_cast<size_t>(reference) > arrays.size()) {
+            return nullptr;
+        }
+        auto &array = arrays[static_cast<size_t>(reference - 1)];
+        return array.live ? &array : nullptr;
+    }
+    template <bool Checked>
+    [[nodiscard]] std::vector<Value> &getArrayByReference(Value reference) {
+        if constexpr (Checked) {
+            auto *array = findArray(reference);
+            if (array == nullptr) {
+                throw std::invalid_argument("invalid array reference");
+            }
+            return array->elements;
+        } else {
+            if (reference == 0) {
+                throw std::invalid_argument("invalid array reference");
+            }
+            return arrays[static_cast<size_t>(reference - 1)].elements;
+        }
+    }
+
+    [[nodiscard]] static size_t objectBytes(size_t fieldCount) {
+        return sizeof(ObjectInstance) + fieldCount * sizeof(Value);
+    }
+    [[nodiscard]] static size_t arrayBytes(size_t length) {
+        return sizeof(ArrayInstance) + length * sizeof(Value);
+    }
+
+    // Accounts for a new allocation, collecting first if it would take the
+    // heap past the next collection threshold.
+    void reserveHeap(size_t bytes) {
+        if (heapBytes + bytes > nextCollection) {
+            collectGarbage();
+            if (heapOptions.limit != 0 &&
+                heapBytes + bytes > heapOptions.limit) {
+                throw std::runtime_error(
+                    "heap limit of " + std::to_string(heapOptions.limit) +
+                    " bytes exceeded");
+            }
+        }
+        heapBytes += bytes;
+        gcStats.bytesAllocated += bytes;
+        gcStats.peakBytes = std::max(gcStats.peakBytes, heapBytes);
+    }
+
+    [[nodiscard]] Value allocateObject(std::int64_t classId) {
+        const auto fieldCount = program.getClass(classId).fields.size();
+        reserveHeap(objectBytes(fieldCount));
+        gcStats.objectsAllocated++;
+        ObjectInstance object{.classId = classId,
+                              .fields = std::make_unique<Value[]>(fieldCount)};
+        if (freeObjects.empty()) {
+            objects.push_back(std::move(object));
+            return static_cast<Value>(objects.size());
+        }
+        const auto index = freeObjects.back();
+        freeObjects.pop_back();
+        objects[index] = std::move(object);
+        return static_cast<Value>(index + 1);
+    }
+
+    [[nodiscard]] Value allocateArray(Value length) {
+        if (length < 0) {
+            throw std::invalid_argument("negative array length");
+        }
+        if (static_cast<std::uint64_t>(length) >
+            (std::numeric_limits<size_t>::max() - sizeof(ArrayInstance)) /
+                sizeof(Value)) {
+            throw std::length_error("array length too large");
+        }
+        const auto size = static_cast<size_t>(length);
+        reserveHeap(arrayBytes(size));
+        gcStats.arraysAllocated++;
+        ArrayInstance array{.elements = std::vector<Value>(size, 0)};
+        if (freeArrays.empty()) {
+            arrays.push_back(std::move(array));
+            return static_cast<Value>(arrays.size());
+        }
+        const auto index = freeArrays.back();
+        freeArrays.pop_back();
+        arrays[index] = std::move(array);
+        return static_cast<Value>(index + 1);
+    }
+
+    void mark(ValueKind kind, Value reference, std::vector<size_t> &pending);
+    void markRoots(std::vector<size_t> &pending);
+    void sweep();
+    void collectGarbage();
+
+    // The receiver lives in local slot 0 of every method that accesses
+    // fields, and field indices are validated against the method's class
+    // when it is linked.
+    template <bool Checked> [[nodiscard]] Value &getField(std::int64_t field) {
+        const auto thisReference = getLocal(0);
+        if (thisReference == 0) {
+            throw std::invalid_argument("this not initialized");
+        }
+        auto &object = getObjectByReference<Checked>(thisReference);
+        if (object.classId != frames.back().method->classId) {
+            throw std::invalid_argument(
+                "field access on object of class " +
+                std::string(program.getClass(object.classId).name));
+        }
+        return object.fields[static_cast<size_t>(field)];
+    }
+
+#if MINIJAVA_VM_JIT
+    static Value *jitArrayElement(VM *vm, Value reference,
+                                  Value index) noexcept;
+    static Value jitArrayLength(VM *vm, Value reference) noexcept;
+    static Value *jitFieldAddress(VM *vm, std::int64_t field) noexcept;
+    static constexpr JitHelpers jitHelpers{.arrayElement = jitArrayElement,
+                                           .arrayLength = jitArrayLength,
+                                           .fieldAddress = jitFieldAddress};
+
+    bool hasNativeCode(const Method &method, size_t pc);
+    void runNative();
+    // Times the interpreter continued in compiled code, for VmRunStats.
+    std::uint64_t nativeEntries = 0;
+#endif
+
+
+    // Pops the operand stack the interpreter holds in sp and tos.
+    template <bool Checked> Value pop(Value *&sp, Value &tos) {
+        if constexpr (Checked) {
+            if (sp == dataStack.data()) {
+                throw std::runtime_error("empty data stack");
+            }
+        }
+        const auto value = tos;
+        --sp;
+        tos = sp[-1];
+        return value;
+    }
+    // The top of the operand stack the interpreter holds in sp and tos, which
+    // unary and binary operators overwrite with their result.
+    template <bool Checked> Value &top(Value *sp, Value &tos) {
+        if constexpr (Checked) {
+            if (sp == dataStack.data()) {
+                throw std::runtime_error("empty data stack");
+            }
+        }
+        return tos;
+    }
+
+  public:
+    explicit VM(Program program_, HeapOptions heapOptions_ = {},
+                JitOptions jitOptions_ = {},
+                InterpreterOptions interpreterOptions_ = {},
+                std::ostream &output_ = std::cout,
+                std::ostream &errors_ = std::cerr)
+        : program{std::move(program_)}, heapOptions{heapOptions_},
+          jitOptions{jitOptions_}, interpreterOptions{interpreterOptions_},
+          output{&output_}, errors{&errors_} {
+        frames.reserve(initialFrameCapacity);
+        locals.reserve(initialLocalsCapacity);
+        if (heapOptions.limit != 0) {
+            nextCollection = std::min(nextCollection, heapOptions.limit);
+        }
+        // Compiled code is not instrumented, and keeps none of the checks
+        // --checked asks for.
+        if (interpreterOptions.profile || interpreterOptions.perfCounters ||
+            interpreterOptions.countInstructions ||
+            interpreterOptions.checked) {
+            jitOptions.enabled = false;
+        }
+        pushFrame(program.getMain());
+    };
+    void run();
+    // Returns false when an unchecked run reaches a call into an unverified
+    // method, leaving that call for the checked interpreter.
+    template <bool Checked, Instrumentation Mode> bool execute();
+    template <Instrumentation Mode> void runFrom();
+#if MINIJAVA_VM_PROFILER
+    // Counters to read around the run for --perf-counters. They must stay
+    // open until the VM has printed them.
+    void measureWith(PerfCounters &counters) { perfCounters = &counters; }
+#endif
+
+    void printstack() {
+        std::cout << "stack top: ";
+        if (!dataStack.empty()) {
+            std::cout << dataStack.back() << '\n';
+        }
+    }
+    void printGcStats(std::ostream &os) const;
+    void printCallStats(std::ostream &os) const;
+    void printLoadStats(std::ostream &os) const;
+#if MINIJAVA_VM_PROFILER
+    void printProfile(std::ostream &os) const;
+    void writeProfileJson(std::ostream &os) const;
+    void printPerfCounters(std::ostream &os) const;
+#endif
+    // Fills in what the VM itself knows; the caller times the run.
+    void getRunStats(VmRunStats &stats) const;
+#if MINIJAVA_VM_PROFILER
+    // The lines of the --profile-source file, with their indentation
+    // trimmed; empty if there is none.
+    [[nodiscard]] std::vector<std::string> readSourceLines() const;
+#endif
+#if MINIJAVA_VM_SAMPLER
+    void writeSamples(std::ostream &os) const;
+#endif
+};
+
+// Objects are queued so that their fields are traced without recursion.
+// References that do not name a live slot (null, or values the mutator would
+// reject anyway) are ignored.
+void VM::mark(ValueKind kind, Value reference, std::vector<size_t> &pending) {
+    if (reference <= 0) {
+        return;
+    }
+    const auto index = static_cast<size_t>(reference - 1);
+    if (kind == ValueKind::Object && index < objects.size()) {
+        auto &object = objects[index];
+        if (object.live && !object.marked) {
+            object.marked = true;
+            pending.push_back(index);
+        }
+    } else if (kind == ValueKind::Array && index < arrays.size()) {
+        arrays[index].marked = arrays[index].live;
+    }
+}
+
+// The roots are the locals of every frame, "this" included, and the operand
+// stack. Every frame is stopped just after an allocation or a call, so the
+// stack map of the instruction before its pc describes its part of the
+// operand stack; the parts are laid out bottom to top in frame order.
+void VM::markRoots(std::vector<size_t> &pending) {
+    size_t stackIndex = 0;
+    for (const auto &frame : frames) {
+        const auto &method = *frame.method;
+        for (size_t slot = 0; slot < method.localKinds.size(); slot++) {
+            mark(method.localKinds[slot], locals[frame.localsBase + slot],
+                 pending);
+        }
+        const auto stackMap = method.stackMaps.find(frame.pc - 1);
+        if (stackMap == method.stackMaps.end() ||
+            stackIndex + stackMap->second.size() > dataStack.size()) {
+            throw std::logic_error("operand stack does not match stack maps");
+        }
+        for (const auto kind : stackMap->second) {
+            mark(kind, dataStack[stackIndex++], pending);
+        }
+    }
+    if (stackIndex != dataStack.size()) {
+        throw std::logic_error("operand stack does not match stack maps");
+    }
+}
+
+void VM::sweep() {
+    for (size_t i = 0; i < objects.size(); i++) {
+        auto &object = objects[i];
+        if (!object.live || std::exchange(object.marked, false)) {
+            continue;
+        }
+        const auto bytes =
+            objectBytes(program.getClass(object.classId).fields.size());
+        object.fields.reset();
+        object.live = false;
+        freeObjects.push_back(i);
+        heapBytes -= bytes;
+        gcStats.bytesFreed += bytes;
+        gcStats.objectsFreed++;
+    }
+    for (size_t i = 0; i < arrays.size(); i++) {
+        auto &array = arrays[i];
+        if (!array.live || std::exchange(array.marked, false)) {
+            continue;
+        }
+        const auto bytes = arrayBytes(array.elements.size());
+        std::vector<Value>().swap(array.elements);
+        array.live = false;
+        freeArrays.push_back(i);
+        heapBytes -= bytes;
+        gcStats.bytesFreed += bytes;
+        gcStats.arraysFreed++;
+    }
+}
+
+// Stop-the-world mark and sweep. The next collection is scheduled once the
+// heap has doubled from what survived, capped by the heap limit.
+void VM::collectGarbage() {
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<size_t> pending;
+    markRoots(pending);
+    while (!pending.empty()) {
+        const auto &object = objects[pending.back()];
+        pending.pop_back();
+        const auto &fieldKinds = program.getClass(object.classId).fieldKinds;
+        for (size_t field = 0; field < fieldKinds.size(); field++) {
+            mark(fieldKinds[field], object.fields[field], pending);
+        }
+    }
+    sweep();
+
+    nextCollection = std::max(initialCollectionThreshold, 2 * heapBytes);
+    if (heapOptions.limit != 0) {
+        nextCollection = std::min(nextCollection, heapOptions.limit);
+    }
+    gcStats.collections++;
+    gcStats.pauseTime += std::chrono::steady_clock::now() - start;
+}
+
+#if MINIJAVA_VM_JIT
+Value *VM::jitArrayElement(VM *vm, Value reference, Value index) noexcept {
+    auto *array = vm->findArray(reference);
+    if (array == nullptr || index < 0 ||
+        static_cast<size_t>(index) >= array->elements.size()) {
+        return nullptr;
+    }
+    return &array->elements[static_cast<size_t>(index)];
+}
+
+Value VM::jitArrayLength(VM *vm, Value reference) noexcept {
+    const auto *array = vm->findArray(reference);
+    return array != nullptr ? static_cast<Value>(array->elements.size()) : -1;
+}
+
+Value *VM::jitFieldAddress(VM *vm, std::int64_t field) noexcept {
+    const auto thisReference = vm->getLocal(0);
+    if (thisReference <= 0 ||
+        static_cast<size_t>(thisReference) > vm->objects.size()) {
+        return nullptr;
+    }
+    auto &object = vm->objects[static_cast<size_t>(thisReference - 1)];
+    if (!object.live || object.classId != vm->frames.back().method->classId) {
+        return nullptr;
+    }
+    return &object.fields[static_cast<size_t>(field)];
+}
+
+// Whether the method has compiled code worth entering at pc. Each call
+// counts towards making the method hot, and compiles it once it is.
+// Compiled code has none of the interpreter's structural checks, so methods
+// the verifier rejected are never compiled.
+bool VM::hasNativeCode(const Method &method, size_t pc) {
+    auto &jit = method.jit;
+    if (jit.code == nullptr) {
+        if (!jitOptions.enabled || !method.verified || jit.failed ||
+            ++jit.hotness < jitOptions.threshold) {
+            return false;
+        }
+        jit.code = compileNative(method, jitHelpers);
+        jit.failed = jit.code == nullptr;
+        if (jit.failed) {
+            return false;
+        }
+    }
+    return jit.code->entersAt(pc);
+}
+
+// Runs compiled code from the current frame's pc until it reaches an
+// instruction it leaves to the interpreter. The operand stack is grown by
+// the method's maximum depth first, so compiled code never has to check for
+// room, and trimmed back afterwards.
+void VM::runNative() {
+    auto &frame = frames.back();
+    const auto &method = *frame.method;
+    if (frame.pc >= method.code.size()) {
+        return;
+    }
+    nativeEntries += 1;
+    const auto depth = dataStack.size();
+    dataStack.resize(depth + method.maxStackDepth);
+    JitFrame jitFrame{.sp = dataStack.data() + depth,
+                      .locals = locals.data() + frame.localsBase,
+                      .vm = this};
+    frame.pc = static_cast<size_t>(
+        method.jit.code->run(jitFrame, static_cast<std::int64_t>(frame.pc)));
+    dataStack.resize(static_cast<size_t>(jitFrame.sp - dataStack.data()));
+}
+#endif
+
+void VM::printCallStats(std::ostream &os) const {
+    os << "Call statistics:\n"
+       << "  calls:               " << callStats.hits + callStats.misses
+       << "\n"
+       << "  inline cache hits:   " << callStats.hits << "\n"
+       << "  inline cache misses: " << callStats.misses << "\n";
+}
+
+void VM::printLoadStats(std::ostream &os) const {
+    const auto &stats = program.getLoadStats();
+    const auto decodeMs =
+        std::chrono::duration<double, std::milli>(stats.decodeTime).count();
+    os << "Load statistics:\n"
+       << "  methods decoded:      " << stats.methodsDecoded << " of "
+       << stats.methods << "\n";
+    if (stats.codeBytes != 0) {
+        os << "  code bytes decoded:   " << stats.codeBytesDecoded << " of "
+           << stats.codeBytes << "\n";
+    }
+    os << "  instructions decoded: " << stats.instructionsDecoded << " ("
+       << stats.instructionsDecoded * sizeof(Instruction) << " bytes)\n"
+       << "  decode time:          " << decodeMs << " ms\n";
+}
+
+#if MINIJAVA_VM_PROFILER
+// What a profiled run spent in each method, block and opcode, sorted by the
+// number of instructions executed.
+struct ProfileSummary {
+    struct BlockRow {
+        std::string_view name;
+        std::uint64_t entries = 0;
+        std::uint64_t instructions = 0;
+    };
+    struct LineRow {
+        int line = 0;
+        std::uint64_t instructions = 0;
+    };
+    struct MethodRow {
+        std::string_view name;
+        const MethodProfile *profile = nullptr;
+        std::uint64_t exclusive = 0;
+        std::vector<BlockRow> blocks;
+        // In line order; empty if the program has no line table.
+        std::vector<LineRow> lines;
+    };
+    std::uint64_t instructions = 0;
+    std::vector<MethodRow> methods;
+    std::vector<std::pair<Opcode, std::uint64_t>> opcodes;
+
+    explicit ProfileSummary(const Program &program) {
+        std::vector<std::uint64_t> opcodeCounts(Opcode::PUTFIELD + 1);
+        const auto sourceLines = program.readLines();
+        program.forEachNamedMethod([&](std::string_view name,
+                                       const Method &method) {
+            const auto &profile = method.profile;
+            if (profile.calls == 0) {
+                return;
+            }
+            MethodRow row{
+                .name = name, .profile = &profile, .blocks = {}, .lines = {}};
+            for (size_t pc = 0; pc < method.code.size(); pc++) {
+                row.exclusive += profile.counts[pc];
+                opcodeCounts[static_cast<size_t>(method.code[pc].op)] +=
+                    profile.counts[pc];
+            }
+            for (size_t i = 0; i < method.labels.size(); i++) {
+                const auto &[label, begin] = method.labels[i];
+                const auto end = i + 1 < method.labels.size()
+                                     ? method.labels[i + 1].second
+                                     : method.code.size();
+                BlockRow block{.name = label};
+                if (begin < end) {
+                    block.entries = profile.counts[begin];
+                }
+                for (size_t pc = begin; pc < end; pc++) {
+                    block.instructions += profile.counts[pc];
+                }
+                if (block.instructions != 0) {
+                    row.blocks.push_back(block);
+                }
+            }
+            std::ranges::stable_sort(row.blocks, std::greater{},
+                                     &BlockRow::instructions);
+            if (const auto found = sourceLines.find(name);
+                found != sourceLines.end() &&
+                found->second.size() == method.code.size()) {
+                std::map<int, std::uint64_t> lineCounts;
+                for (size_t pc = 0; pc < method.code.size(); pc++) {
+                    if (found->second[pc] != 0 && profile.counts[pc] != 0) {
+                        lineCounts[found->second[pc]] += profile.counts[pc];
+                    }
+                }
+                for (const auto &[line, count] : lineCounts) {
+                    row.lines.push_back(
+                        {.line = line, .instructions = count});
+                }
+            }
+            instructions += row.exclusive;
+            methods.push_back(std::move(row));
+        });
+        std::ranges::stable_sort(methods, std::greater{},
+                                 &MethodRow::exclusive);
+
+        for (size_t op = 0; op < opcodeCounts.size(); op++) {
+            if (opcodeCounts[op] != 0) {
+                opcodes.emplace_back(static_cast<Opcode>(op),
+                                     opcodeCounts[op]);
+            }
+        }
+        std::ranges::stable_sort(opcodes, std::greater{},
+                                 &std::pair<Opcode, std::uint64_t>::second);
+    }
+
+    [[nodiscard]] double percent(std::uint64_t count) const {
+        return instructions == 0 ? 0.0 : 100.0 * count / instructions;
+    }
+};
+
+std::vector<std::string> VM::readSourceLines() const {
+    std::vector<std::string> lines;
+    std::ifstream source(interpreterOptions.sourcePath);
+    if (interpreterOptions.sourcePath.empty() || !source.is_open()) {
+        return lines;
+    }
+    for (std::string line; std::getline(source, line);) {
+        const auto begin = line.find_first_not_of(" \t");
+        lines.push_back(begin == std::string::npos ? std::string()
+                                                   : line.substr(begin));
+    }
+    return lines;
+}
+
+void VM::printProfile(std::ostream &os) const {
+    // How many of the hottest blocks and lines, across all methods, to list.
+    constexpr size_t hotBlocks = 20;
+    constexpr size_t hotLines = 20;
+
+    const ProfileSummary summary(program);
+    const auto flags = os.flags();
+    const auto precision = os.precision();
+    os << std::fixed << std::setprecision(1);
+    os << "Profile: " << summary.instructions << " instructions executed\n"
+       << "\nMethods:\n"
+       << std::setw(12) << "calls" << std::setw(14) << "self" << std::setw(8)
+       << "%" << std::setw(14) << "total" << std::setw(8) << "%"
+       << "  method\n";
+    for (const auto &row : summary.methods) {
+        os << std::setw(12) << row.profile->calls << std::setw(14)
+           << row.exclusive << std::setw(8) << summary.percent(row.exclusive)
+           << std::setw(14) << row.profile->inclusive << std::setw(8)
+           << summary.percent(row.profile->inclusive) << "  " << row.name
+           << "\n";
+    }
+
+    os << "\nOpcodes:\n"
+       << std::setw(14) << "count" << std::setw(8) << "%" << "  opcode\n";
+    for (const auto &[op, count] : summary.opcodes) {
+        os << std::setw(14) << count << std::setw(8) << summary.percent(count)
+           << "  " << mnemonics[static_cast<size_t>(op)] << "\n";
+    }
+
+    std::vector<std::pair<std::string_view,
+                          const ProfileSummary::BlockRow *>>
+        blocks;
+    for (const auto &row : summary.methods) {
+        for (const auto &block : row.blocks) {
+            blocks.emplace_back(row.name, &block);
+        }
+    }
+    std::ranges::stable_sort(blocks, [](const auto &a, const auto &b) {
+        return a.second->instructions > b.second->instructions;
+    });
+    if (blocks.size() > hotBlocks) {
+        blocks.resize(hotBlocks);
+    }
+    os << "\nHottest blocks:\n"
+       << std::setw(12) << "entries" << std::setw(14) << "instructions"
+       << std::setw(8) << "%" << "  block\n";
+    for (const auto &[method, block] : blocks) {
+        os << std::setw(12) << block->entries << std::setw(14)
+           << block->instructions << std::setw(8)
+           << summary.percent(block->instructions) << "  " << method << " "
+           << block->name << "\n";
+    }
+
+    std::vector<std::pair<std::string_view, const ProfileSummary::LineRow *>>
+        lines;
+    for (const auto &row : summary.methods) {
+        for (const auto &line : row.lines) {
+            lines.emplace_back(row.name, &line);
+        }
+    }
+    if (!lines.empty()) {
+        std::ranges::stable_sort(lines, [](const auto &a, const auto &b) {
+            return a.second->instructions > b.second->instructions;
+        });
+        if (lines.size() > hotLines) {
+            lines.resize(hotLines);
+        }
+        const auto source = readSourceLines();
+        os << "\nHottest lines:\n"
+           << std::setw(14) << "instructions" << std::setw(8) << "%"
+           << "  line\n";
+        for (const auto &[method, line] : lines) {
+            os << std::setw(14) << line->instructions << std::setw(8)
+               << summary.percent(line->instructions) << "  " << method << ":"
+               << line->line;
+            const auto index = static_cast<size_t>(line->line - 1);
+            if (index < source.size()) {
+                os << "\t" << source[index];
+            }
+            os << "\n";
+        }
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+void VM::writeProfileJson(std::ostream &os) const {
+    const ProfileSummary summary(program);
+    os << "{\n  \"instructions\": " << summary.instructions
+       << ",\n  \"methods\": [";
+    for (size_t i = 0; i < summary.methods.size(); i++) {
+        const auto &row = summary.methods[i];
+        os << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+        writeJsonString(os, row.name);
+        os << ", \"calls\": " << row.profile->calls
+           << ", \"exclusive\": " << row.exclusive
+           << ", \"inclusive\": " << row.profile->inclusive
+           << ", \"blocks\": [";
+        for (size_t j = 0; j < row.blocks.size(); j++) {
+            const auto &block = row.blocks[j];
+            os << (j == 0 ? "" : ", ") << "{\"name\": ";
+            writeJsonString(os, block.name);
+            os << ", \"entries\": " << block.entries
+               << ", \"instructions\": " << block.instructions << "}";
+        }
+        os << "], \"lines\": [";
+        for (size_t j = 0; j < row.lines.size(); j++) {
+            const auto &line = row.lines[j];
+            os << (j == 0 ? "" : ", ") << "{\"line\": " << line.line
+               << ", \"instructions\": " << line.instructions << "}";
+        }
+        os << "]}";
+    }
+    os << "\n  ],\n  \"opcodes\": {";
+    for (size_t i = 0; i < summary.opcodes.size(); i++) {
+        const auto &[op, count] = summary.opcodes[i];
+        os << (i == 0 ? "\n    " : ",\n    ");
+        writeJsonString(os, mnemonics[static_cast<size_t>(op)]);
+        os << ": " << count;
+    }
+    os << "\n  }\n}\n";
+}
+#endif
+
+#if MINIJAVA_VM_SAMPLER
+// One line per call stack, "outer;inner count", the collapsed format that
+// flamegraph.pl and speedscope read.
+void VM::writeSamples(std::ostream &os) const {
+    std::unordered_map<const Method *, std::string_view> names;
+    program.forEachNamedMethod([&](std::string_view name,
+                                   const Method &method) {
+        names.emplace(&method, name);
+    });
+    std::vector<std::pair<std::string, std::uint64_t>> lines;
+    lines.reserve(samples.size());
+    for (const auto &[stack, ticks] : samples) {
+        std::string line;
+        for (const auto *method : stack) {
+            if (!line.empty()) {
+                line += ';';
+            }
+            line += names.at(method);
+        }
+        lines.emplace_back(std::move(line), ticks);
+    }
+    std::ranges::sort(lines);
+    for (const auto &[line, ticks] : lines) {
+        os << line << ' ' << ticks << '\n';
+    }
+}
+#endif
+
+#if MINIJAVA_VM_PROFILER
+void VM::printPerfCounters(std::ostream &os) const {
+    constexpr std::array events = {PerfEvent::Cycles, PerfEvent::Instructions,
+                                   PerfEvent::BranchMisses,
+                                   PerfEvent::CacheMisses};
+    const auto ratio = [](std::uint64_t count, std::uint64_t per) {
+        return per == 0 ? 0.0
+                        : static_cast<double>(count) /
+                              static_cast<double>(per);
+    };
+    const auto flags = os.flags();
+    const auto precision = os.precision();
+    os << std::fixed << std::setprecision(2) << "Performance counters:\n";
+    for (const auto event : events) {
+        os << "  " << std::left << std::setw(34)
+           << std::string(perfEventName(event)) + ":" << std::right;
+        if (perfCounters->available(event)) {
+            os << perfTotal[event] << "\n";
+        } else {
+            os << "not supported\n";
+        }
+    }
+    const auto cycles = perfTotal[PerfEvent::Cycles];
+    const auto instructions = perfTotal[PerfEvent::Instructions];
+    os << "  bytecode instructions:            " << instructionsExecuted
+       << "\n"
+       << "  instructions per cycle:           " << ratio(instructions, cycles)
+       << "\n"
+       << "  cycles per bytecode instruction:  "
+       << ratio(cycles, instructionsExecuted) << "\n"
+       << "  instructions per bytecode instr.: "
+       << ratio(instructions, instructionsExecuted) << "\n"
+       << "  branch misses per 1000 bytecodes: "
+       << 1000 * ratio(perfTotal[PerfEvent::BranchMisses],
+                       instructionsExecuted)
+       << "\n";
+
+    if (!methodCounters.empty()) {
+        std::unordered_map<const Method *, std::string_view> names;
+        program.forEachNamedMethod([&](std::string_view name,
+                                       const Method &method) {
+            names.emplace(&method, name);
+        });
+        std::vector<std::pair<const Method *, const MethodCounters *>> rows;
+        for (const auto &[method, counters] : methodCounters) {
+            rows.emplace_back(method, &counters);
+        }
+        std::ranges::sort(rows, [](const auto &a, const auto &b) {
+            return a.second->self[PerfEvent::Cycles] >
+                   b.second->self[PerfEvent::Cycles];
+        });
+        os << "\nPer-method counters (excluding callees):\n"
+           << std::setw(12) << "calls";
+        for (const auto event : events) {
+            os << std::setw(15) << perfEventName(event);
+        }
+        os << "  method\n";
+        for (const auto &[method, counters] : rows) {
+            os << std::setw(12) << counters->calls;
+            for (const auto event : events) {
+                os << std::setw(15) << counters->self[event];
+            }
+            os << "  " << names.at(method) << "\n";
+        }
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+#endif
+
+void VM::getRunStats(VmRunStats &stats) const {
+#if MINIJAVA_VM_PROFILER
+    stats.instructions = instructionsExecuted;
+#endif
+#if MINIJAVA_VM_JIT
+    stats.nativeEntries = nativeEntries;
+#endif
+    stats.objectsAllocated = gcStats.objectsAllocated;
+    stats.arraysAllocated = gcStats.arraysAllocated;
+    stats.heapBytesAllocated = gcStats.bytesAllocated;
+    stats.peakHeapBytes = gcStats.peakBytes;
+    stats.collections = gcStats.collections;
+}
+
+void VM::printGcStats(std::ostream &os) const {
+    const auto pauseMs =
+        std::chrono::duration<double, std::milli>(gcStats.pauseTime).count();
+    os << "GC statistics:\n"
+       << "  collections:     " << gcStats.collections << "\n"
+       << "  objects freed:   " << gcStats.objectsFreed << "\n"
+       << "  arrays freed:    " << gcStats.arraysFreed << "\n"
+       << "  bytes freed:     " << gcStats.bytesFreed << "\n"
+       << "  live heap bytes: " << heapBytes << "\n"
+       << "  peak heap bytes: " << gcStats.peakBytes << "\n"
+       << "  total pause:     " << pauseMs << " ms\n";
+}
+
+#if MINIJAVA_VM_THREADED_DISPATCH
+void VM::decodeThreaded(Method &method, const DispatchTable &table) {
+    method.threadedCode.clear();
+    method.threadedCode.reserve(method.code.size() + 1);
+    for (const auto &instruction : method.code) {
+        const auto index =
+            static_cast<size_t>(static_cast<std::uint8_t>(instruction.op));
+        const void *handler =
+            index < table.size ? table.handlers[index] : table.invalidOpcode;
+        if ((instruction.op == Opcode::JMP || instruction.op == Opcode::CJMP) &&
+            instruction.argNumber < 0) {
+            handler = table.unresolvedJump;
+        }
+        method.threadedCode.push_back(
+            {.handler = handler, .operand = instruction.argNumber});
+    }
+    // Running off the end of the method lands on this sentinel.
+    method.threadedCode.push_back({.handler = table.endOfCode, .operand = 0});
+}
+
+// Taking the address of a label is a GCC/Clang extension.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+// The opcode bodies below are shared by both interpreter loops. With
+// MINIJAVA_VM_THREADED_DISPATCH every method is pre-decoded into handler
+// addresses and each body jumps straight to the next handler; otherwise they
+// are cases of a portable switch over the opcode.
+template <bool Checked, Instrumentation Mode> bool VM::execute() {
+#if MINIJAVA_VM_PROFILER
+    // The current method's instruction counts, while profiling.
+    std::uint64_t *profileCounts = nullptr;
+#define VM_PROFILE_LOAD()                                                      \
+    do {                                                                       \
+        if constexpr (Mode == Instrumentation::Counted) {                      \
+            profileCounts = frames.back().method->profile.counts.data();       \
+        }                                                                      \
+    } while (false)
+#define VM_PROFILE_COUNT(pc, delta)                                            \
+    do {                                                                       \
+        if constexpr (Mode == Instrumentation::Counted) {                      \
+            profileCounts[pc] += (delta);                                      \
+        }                                                                      \
+        if constexpr (Mode >= Instrumentation::Measured) {                     \
+            instructionsExecuted += (delta);                                   \
+        }                                                                      \
+    } while (false)
+#define VM_PROFILE_ENTER(callee)                                               \
+    do {                                                                       \
+        if constexpr (Mode == Instrumentation::Counted) {                      \
+            enterProfiled(callee);                                             \
+        }                                                                      \
+        if constexpr (Mode >= Instrumentation::Measured) {                     \
+            if (!measuredCalls.empty()) {                                      \
+                enterMeasured(callee);                                         \
+            }                                                                  \
+        }                                                                      \
+    } while (false)
+#define VM_PROFILE_LEAVE()                                                     \
+    do {                                                                       \
+        if constexpr (Mode == Instrumentation::Counted) {                      \
+            leaveProfiled();                                                   \
+        }                                                                      \
+        if constexpr (Mode >= Instrumentation::Measured) {                     \
+            if (!measuredCalls.empty()) {                                      \
+                leaveMeasured();                                               \
+            }                                                                  \
+        }                                                                      \
+    } while (false)
+#else
+#define VM_PROFILE_LOAD() ((void)0)
+#define VM_PROFILE_COUNT(pc, delta) ((void)0)
+#define VM_PROFILE_ENTER(callee) ((void)0)
+#define VM_PROFILE_LEAVE() ((void)0)
+#endif
+#if MINIJAVA_VM_SAMPLER
+#define VM_SAMPLE()                                                            \
+    do {                                                                       \
+        if constexpr (Mode != Instrumentation::None) {                         \
+            if (pendingSamples.load(std::memory_order_relaxed) != 0) {         \
+                takeSample();                                                  \
+            }                                                                  \
+        }                                                                      \
+    } while (false)
+#else
+#define VM_SAMPLE() ((void)0)
+#endif
+
+#if MINIJAVA_VM_THREADED_DISPATCH
+    // Handler labels, indexed by Opcode value. LOAD and STORE are rewritten
+    // to slot or field opcodes when methods are linked.
+    static const void *const handlers[] = {
+        &&invalid_opcode, &&op_CONST,       &&invalid_opcode, &&op_ADD,
+        &&op_SUB,         &&op_MUL,         &&op_DIV,         &&op_LT,
+        &&op_GT,          &&op_EQ,          &&op_AND,         &&op_OR,
+        &&op_NOT,         &&op_JMP,         &&op_CJMP,        &&op_CALL,
+        &&op_RET,         &&op_PRINT,       &&op_STOP,        &&op_NEW,
+        &&op_NEW_ARRAY,   &&op_ARRAY_LOAD,  &&op_ARRAY_STORE, &&op_ARRAY_LENGTH,
+        &&op_LOAD_LOCAL,  &&op_STORE_LOCAL, &&op_GETFIELD,    &&op_PUTFIELD};
+    static_assert(std::size(handlers) == Opcode::PUTFIELD + 1);
+
+    if (dispatchTable.handlers != handlers) {
+        dispatchTable = {.handlers = handlers,
+                         .size = std::size(handlers),
+                         .invalidOpcode = &&invalid_opcode,
+                         .unresolvedJump = &&unresolved_jump,
+                         .endOfCode = &&end_of_code};
+        program.forEachMethod([this](Method &method) {
+            decodeThreaded(method, dispatchTable);
+        });
+    }
+
+    const Method *method = nullptr;
+    const ThreadedInstruction *code = nullptr;
+    const ThreadedInstruction *ip = nullptr;
+    const ThreadedInstruction *current = nullptr;
+
+#define VM_CASE(name) op_##name
+#define VM_NEXT()                                                              \
+    do {                                                                       \
+        current = ip++;                                                        \
+        VM_PROFILE_COUNT(current - code, 1);                                   \
+        goto *current->handler;                                                \
+    } while (false)
+#define VM_OPERAND() (current->operand)
+#define VM_INSTRUCTION() (method->code[static_cast<size_t>(current - code)])
+#define VM_JUMP_TARGET() (current->operand)
+#define VM_JUMP(target) (ip = code + (target))
+#define VM_PC() (current - code)
+#define VM_SAVE_PC() (frames.back().pc = static_cast<size_t>(ip - code))
+#define VM_LOAD_PC()                                                           \
+    do {                                                                       \
+        method = frames.back().method;                                         \
+        code = method->threadedCode.data();                                    \
+        ip = code + frames.back().pc;                                          \
+        VM_PROFILE_LOAD();                                                     \
+    } while (false)
+
+    VM_LOAD_PC();
+#else
+#define VM_CASE(name) case Opcode::name
+#define VM_NEXT() break
+#define VM_OPERAND() (instruction.argNumber)
+#define VM_INSTRUCTION() (instruction)
+#define VM_JUMP_TARGET() (jumpTarget<Checked>(instruction))
+#define VM_JUMP(target) (frames.back().pc = static_cast<size_t>(target))
+#define VM_PC() (static_cast<std::int64_t>(frames.back().pc) - 1)
+#define VM_SAVE_PC() ((void)0)
+#define VM_LOAD_PC() VM_PROFILE_LOAD()
+
+    VM_LOAD_PC();
+#endif
+
+    // The operand stack is kept in locals while the loop runs: sp points
+    // just past the top value, and the top value itself lives in tos rather
+    // than in sp[-1]. VM_SAVE_STACK writes both back to dataStack, which
+    // must happen before anything that reads or grows it.
+    if constexpr (!Checked) {
+        dataStack.reserve(frames.back().method->maxStackDepth);
+    }
+    Value *sp = nullptr;
+    Value tos = 0;
+#define VM_LOAD_STACK()                                                        \
+    do {                                                                       \
+        sp = dataStack.data() + dataStack.size();                              \
+        tos = sp[-1];                                                          \
+    } while (false)
+#define VM_SAVE_STACK()                                                        \
+    do {                                                                       \
+        sp[-1] = tos;                                                          \
+        dataStack.resize(static_cast<size_t>(sp - dataStack.data()));         \
+    } while (false)
+// Unchecked pushes rely on pushFrame having reserved the method's maximum
+// stack depth.
+#define VM_PUSH(value)                                                         \
+    do {                                                                       \
+        const Value pushed = (value);                                          \
+        if constexpr (Checked) {                                               \
+            if (sp == dataStack.data() + dataStack.capacity()) {               \
+                VM_SAVE_STACK();                                               \
+                dataStack.reserve(1);                                          \
+                VM_LOAD_STACK();                                               \
+            }                                                                  \
+        }                                                                      \
+        sp[-1] = tos;                                                          \
+        tos = pushed;                                                          \
+        ++sp;                                                                  \
+    } while (false)
+#define VM_POP() pop<Checked>(sp, tos)
+#define VM_TOP() top<Checked>(sp, tos)
+
+#if MINIJAVA_VM_JIT
+// Continues the current frame in compiled code if its method has any worth
+// entering there. Only method entry and loop back edges try this, and count
+// towards making the method hot: resuming a caller after a return would
+// mostly run to its next call and leave again.
+#define VM_ENTER_NATIVE()                                                      \
+    do {                                                                       \
+        VM_SAVE_PC();                                                          \
+        if (hasNativeCode(*frames.back().method, frames.back().pc)) {          \
+            VM_SAVE_STACK();                                                   \
+            runNative();                                                       \
+            VM_LOAD_PC();                                                      \
+            VM_LOAD_STACK();                                                   \
+        }                                                                      \
+    } while (false)
+#define VM_LOOP_JUMP(target)                                                   \
+    do {                                                                       \
+        const auto loopTarget = (target);                                      \
+        const auto backEdge = loopTarget <= VM_PC();                           \
+        VM_JUMP(loopTarget);                                                   \
+        if (backEdge) {                                                        \
+            VM_ENTER_NATIVE();                                                 \
+        }                                                                      \
+    } while (false)
+#else
+#define VM_ENTER_NATIVE() ((void)0)
+#define VM_LOOP_JUMP(target) VM_JUMP(target)
+#endif
+    VM_LOAD_STACK();
+#if MINIJAVA_VM_THREADED_DISPATCH
+    VM_NEXT();
+#else
+    while (true) {
+        const auto &instruction = step<Checked>();
+        VM_PROFILE_COUNT(frames.back().pc - 1, 1);
+
+        switch (instruction.op) {
+#endif
+    VM_CASE(STOP) : {
+        // std::cout << "Reached end of program.\n";
+        VM_SAVE_STACK();
+        return true;
+    }
+    VM_CASE(RET) : {
+        if constexpr (Checked) {
+            if (frames.size() <= 1) {
+                throw std::runtime_error("return outside of a method call");
+            }
+        }
+        VM_SAMPLE();
+        popFrame();
+        VM_PROFILE_LEAVE();
+        VM_LOAD_PC();
+        // std::cout << "Returning from method.\n";
+        VM_NEXT();
+    }
+    VM_CASE(CALL) : {
+        const auto &callSite = VM_INSTRUCTION();
+        const auto *callee = resolveCall(callSite);
+        if (callee == nullptr) {
+            *errors << "error: no activation found for method "
+                    << callSite.argString << "\n";
+            return true;
+        }
+        if constexpr (!Checked) {
+            if (!callee->verified) {
+                // The checked interpreter runs, and counts, the call again.
+                VM_PROFILE_COUNT(VM_PC(), -1);
+                frames.back().pc = static_cast<size_t>(VM_PC());
+                VM_SAVE_STACK();
+                return false;
+            }
+        }
+        VM_SAMPLE();
+        VM_SAVE_PC();
+        VM_SAVE_STACK();
+        pushFrame<Checked>(*callee);
+        VM_PROFILE_ENTER(*callee);
+        VM_LOAD_PC();
+        VM_LOAD_STACK();
+        VM_ENTER_NATIVE();
+        // std::cout << "Calling method " << name << "\n";
+        VM_NEXT();
+    }
+    VM_CASE(JMP) : {
+        VM_SAMPLE();
+        VM_LOOP_JUMP(VM_JUMP_TARGET());
+        VM_NEXT();
+    }
+    VM_CASE(CJMP) : {
+        VM_SAMPLE();
+        const auto conditionValue = VM_POP();
+        if (conditionValue == 0) {
+            VM_LOOP_JUMP(VM_JUMP_TARGET());
+        }
+        VM_NEXT();
+    }
+    VM_CASE(PRINT) : {
+        const auto value = VM_POP();
+        *output << value << "\n";
+        VM_NEXT();
+    }
+    // Allocation may collect garbage, which reads the pc of every frame to
+    // find its stack map.
+    VM_CASE(NEW) : {
+        VM_SAVE_PC();
+        VM_SAVE_STACK();
+        VM_PUSH(allocateObject(VM_OPERAND()));
+        VM_NEXT();
+    }
+    VM_CASE(NEW_ARRAY) : {
+        const auto length = VM_POP();
+        VM_SAVE_PC();
+        VM_SAVE_STACK();
+        VM_PUSH(allocateArray(length));
+        VM_NEXT();
+    }
+    VM_CASE(ARRAY_LOAD) : {
+        const auto index = VM_POP();
+        const auto arrayReference = VM_POP();
+        const auto &array = getArrayByReference<Checked>(arrayReference);
+        if (index < 0 || static_cast<size_t>(index) >= array.size()) {
+            throw std::invalid_argument("array index out of bounds");
+        }
+        VM_PUSH(array[static_cast<size_t>(index)]);
+        VM_NEXT();
+    }
+    VM_CASE(ARRAY_STORE) : {
+        const auto value = VM_POP();
+        const auto index = VM_POP();
+        const auto arrayReference = VM_POP();
+        auto &array = getArrayByReference<Checked>(arrayReference);
+        if (index < 0 || static_cast<size_t>(index) >= array.size()) {
+            throw std::invalid_argument("array index out of bounds");
+        }
+        array[static_cast<size_t>(index)] = value;
+        VM_NEXT();
+    }
+    VM_CASE(ARRAY_LENGTH) : {
+        const auto arrayReference = VM_POP();
+        const auto &array = getArrayByReference<Checked>(arrayReference);
+        VM_PUSH(static_cast<Value>(array.size()));
+        VM_NEXT();
+    }
+    VM_CASE(ADD) : {
+        const auto x = VM_POP();
+        auto &y = VM_TOP();
+        y = x + y;
+        VM_NEXT();
+    }
+    VM_CASE(SUB) : {
+        const auto x = VM_POP();
+        auto &y = VM_TOP();
+        y = y - x;
+        VM_NEXT();
+    }
+    VM_CASE(MUL) : {
+        const auto x = VM_POP();
+        auto &y = VM_TOP();
+        y = x * y;
+        VM_NEXT();
+    }
+    VM_CASE(DIV) : {
+        const auto x = VM_POP();
+        auto &y = VM_TOP();
+        if (x == 0) {
+            throw std::invalid_argument("division by zero");
+        }
+        // The one quotient that does not fit wraps around, like the other
+        // arithmetic, instead of trapping.
+        y = x == -1 ? static_cast<Value>(0 - static_cast<std::uint64_t>(y))
+                    : y / x;
+        VM_NEXT();
+    }
+    VM_CASE(LT) : {
+        const auto x = VM_POP();
+        auto &y = VM_TOP();
+        y = x > y ? 1 : 0;
+        VM_NEXT();
+    }
+    VM_CASE(GT) : {
+        const auto x = VM_POP();
+        auto &y = VM_TOP();
+        y = x < y ? 1 : 0;
+        VM_NEXT();
+    }
+    VM_CASE(AND) : {
+        const auto x = VM_POP();
+        auto &y = VM_TOP();
+        y = x * y == 0 ? 0 : 1;
+        VM_NEXT();
+    }
+    VM_CASE(OR) : {
+        const auto x = VM_POP();
+        auto &y = VM_TOP();
+        y = x + y == 0 ? 0 : 1;
+        VM_NEXT();
+    }
+    VM_CASE(EQ) : {
+        const auto x = VM_POP();
+        auto &y = VM_TOP();
+        y = x == y ? 1 : 0;
+        VM_NEXT();
+    }
+    VM_CASE(NOT) : {
+        auto &x = VM_TOP();
+        x = x == 0 ? 1 : 0;
+        VM_NEXT();
+    }
+    VM_CASE(CONST) : {
+        VM_PUSH(VM_OPERAND());
+        VM_NEXT();
+    }
+    VM_CASE(LOAD_LOCAL) : {
+        VM_PUSH(getLocal(VM_OPERAND()));
+        VM_NEXT();
+    }
+    VM_CASE(STORE_LOCAL) : {
+        setLocal(VM_OPERAND(), VM_POP());
+        VM_NEXT();
+    }
+    VM_CASE(GETFIELD) : {
+        VM_PUSH(getField<Checked>(VM_OPERAND()));
+        VM_NEXT();
+    }
+    VM_CASE(PUTFIELD) : {
+        const auto value = VM_POP();
+        getField<Checked>(VM_OPERAND()) = value;
+        VM_NEXT();
+    }
+#if MINIJAVA_VM_THREADED_DISPATCH
+invalid_opcode : {
+    *errors << "Invalid opcode: " << VM_INSTRUCTION().op << "\n";
+    return true;
+}
+unresolved_jump : {
+    (void)jumpTarget<true>(VM_INSTRUCTION());
+    return true;
+}
+end_of_code : {
+    throw std::out_of_range("instruction pointer out of bounds");
+}
+#else
+    default: {
+        *errors << "Invalid opcode: " << instruction.op << "\n";
+        return true;
+    }
+    };
+}
+#endif
+
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_OPERAND
+#undef VM_INSTRUCTION
+#undef VM_JUMP_TARGET
+#undef VM_JUMP
+#undef VM_PC
+#undef VM_SAVE_PC
+#undef VM_LOAD_PC
+#undef VM_ENTER_NATIVE
+#undef VM_LOOP_JUMP
+#undef VM_LOAD_STACK
+#undef VM_SAVE_STACK
+#undef VM_PUSH
+#undef VM_POP
+#undef VM_TOP
+#undef VM_PROFILE_LOAD
+#undef VM_PROFILE_COUNT
+#undef VM_PROFILE_ENTER
+#undef VM_PROFILE_LEAVE
+#undef VM_SAMPLE
+}
+
+#if MINIJAVA_VM_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+
+// Runs unchecked until the program first calls a method the verifier
+// rejected, and checked from that call on.
+template <Instrumentation Mode> void VM::runFrom() {
+    if (!interpreterOptions.checked && frames.back().method->verified &&
+        execute<false, Mode>()) {
+        return;
+    }
+    (void)execute<true, Mode>();
+}
+
+#if MINIJAVA_VM_PROFILER
+// The calls still open when the program stops or fails end there.
+void VM::finishInstrumentation() {
+    while (!profiledCalls.empty()) {
+        leaveProfiled();
+    }
+    if (perfCounters != nullptr) {
+        perfCounters->stop();
+        perfTotal = perfCounters->read();
+        if (!measuredCalls.empty()) {
+            chargeMeasured(perfTotal);
+            measuredCalls.clear();
+        }
+    }
+}
+#endif
+
+void VM::run() {
+#if MINIJAVA_VM_SAMPLER
+    std::optional<SampleTimer> timer;
+    if (!interpreterOptions.samplePath.empty()) {
+        timer.emplace(interpreterOptions.sampleInterval);
+    }
+#endif
+#if MINIJAVA_VM_PROFILER
+    if (interpreterOptions.profile || perfCounters != nullptr ||
+        interpreterOptions.countInstructions) {
+        const auto &main = program.getMain();
+        if (interpreterOptions.profile) {
+            enterProfiled(main);
+        }
+        if (perfCounters != nullptr) {
+            if (interpreterOptions.perMethodCounters) {
+                measuredCalls.push_back(&main);
+                methodCounters[&main].calls++;
+            }
+            perfCounters->start();
+        }
+        try {
+            if (interpreterOptions.profile) {
+                runFrom<Instrumentation::Counted>();
+            } else {
+                runFrom<Instrumentation::Measured>();
+            }
+        } catch (...) {
+            finishInstrumentation();
+            throw;
+        }
+        finishInstrumentation();
+        return;
+    }
+#endif
+#if MINIJAVA_VM_SAMPLER
+    if (timer.has_value()) {
+        runFrom<Instrumentation::Sampled>();
+        return;
+    }
+#endif
+    runFrom<Instrumentation::None>();
+}
+
+[[nodiscard]] Instruction readInstruction(Deserializer &reader) {
+    std::int64_t argNumber = 0;
+    std::string_view argString;
+    auto op = reader.readOpcode();
+    switch (op) {
+    case Opcode::JMP:
+    case Opcode::CJMP:
+    case Opcode::CALL:
+    case Opcode::LOAD:
+    case Opcode::STORE:
+    case Opcode::NEW: {
+        argString = reader.readSymbol();
+        break;
+    }
+    case Opcode::CONST:
+    case Opcode::LOAD_LOCAL:
+    case Opcode::STORE_LOCAL:
+    case Opcode::GETFIELD:
+    case Opcode::PUTFIELD: {
+        argNumber = reader.readSignedInteger();
+        break;
+    }
+    default: {
+        break;
+    }
+    }
+
+    return {op, argNumber, argString};
+}
+
+[[nodiscard]] Block readBlock(Deserializer &reader) {
+    const auto instructionCount = reader.readInteger();
+    // std::cout << "Instruction count: " << instructionCount << "\n";
+    std::vector<Instruction> instructions;
+    instructions.reserve(instructionCount);
+    for (size_t i = 0; i < instructionCount; i++) {
+        instructions.emplace_back(readInstruction(reader));
+    }
+    return {instructions};
+}
+
+// Reads the body of a method whose class and signature came from the method
+// directory.
+[[nodiscard]] Method readMethodBody(Deserializer &reader,
+                                    const std::string &methodName,
+                                    const Method &header,
+                                    const std::vector<ClassLayout> &classes) {
+    auto localVariableNames = reader.readSymbolVector();
+    auto localKinds = reader.readKindVector();
+
+    const auto blockCount = reader.readInteger();
+    // std::cout << "Block count: " << blockCount << "\n";
+    std::vector<std::pair<std::string_view, Block>> blocks;
+    blocks.reserve(blockCount);
+    for (size_t i = 0; i < blockCount; i++) {
+        const auto blockName = reader.readSymbol();
+        // std::cout << "Block: " << blockName << "\n";
+        blocks.emplace_back(blockName, readBlock(reader));
+    }
+
+    return linkMethod(methodName, std::move(localVariableNames),
+                      std::move(localKinds), header.signature, header.classId,
+                      classes, std::move(blocks));
+}
+
+// The in-memory counterpart of readInstruction.
+[[nodiscard]] Instruction
+convertInstruction(const BytecodeInstruction &instruction,
+                   const std::string &methodName) {
+    std::int64_t argNumber = 0;
+    std::string_view argString;
+    const auto op = instruction.getOpcode();
+    const auto missingOperand = [&] {
+        return std::invalid_argument("missing operand in method " +
+                                     methodName);
+    };
+    switch (op) {
+    case Opcode::JMP:
+    case Opcode::CJMP:
+    case Opcode::CALL:
+    case Opcode::LOAD:
+    case Opcode::STORE:
+    case Opcode::NEW: {
+        const auto *withString =
+            dynamic_cast<const StringParameterInstruction *>(&instruction);
+        if (withString == nullptr) {
+            throw missingOperand();
+        }
+        argString = withString->getParam();
+        break;
+    }
+    case Opcode::CONST:
+    case Opcode::LOAD_LOCAL:
+    case Opcode::STORE_LOCAL:
+    case Opcode::GETFIELD:
+    case Opcode::PUTFIELD: {
+        const auto *withNumber =
+            dynamic_cast<const IntegerParameterInstruction *>(&instruction);
+        if (withNumber == nullptr) {
+            throw missingOperand();
+        }
+        argNumber = withNumber->getParam();
+        break;
+    }
+    default: {
+        break;
+    }
+    }
+
+    return {op, argNumber, argString};
+}
+
+// The in-memory counterpart of readMethodBody: names point into the
+// BytecodeMethod instead of the image.
+[[nodiscard]] Method
+convertMethodBody(const BytecodeMethod &bytecodeMethod,
+                  const std::string &methodName, const Method &header,
+                  const std::vector<ClassLayout> &classes) {
+    const auto &variables = bytecodeMethod.getVariables();
+    std::vector<std::pair<std::string_view, Block>> blocks;
+    blocks.reserve(bytecodeMethod.getBlocks().size());
+    for (const auto &bytecodeBlock : bytecodeMethod.getBlocks()) {
+        Block block;
+        block.instructions.reserve(bytecodeBlock.getInstructions().size());
+        for (const auto &instruction : bytecodeBlock.getInstructions()) {
+            block.instructions.push_back(
+                convertInstruction(*instruction, methodName));
+        }
+        blocks.emplace_back(bytecodeBlock.getName(), std::move(block));
+    }
+
+    return linkMethod(methodName, {variables.begin(), variables.end()},
+                      bytecodeMethod.getVariableKinds(), header.signature,
+                      header.classId, classes, std::move(blocks));
+}
+
+// Decodes, links and verifies a method in place. Every method but main
+// starts with its arguments and receiver on the stack.
+void Program::decode(std::string_view name, Method &method) {
+    const auto start = std::chrono::steady_clock::now();
+    const std::string methodName(name);
+    Method decoded;
+    if (method.source != nullptr) {
+        decoded = convertMethodBody(*method.source, methodName, method,
+                                    classes);
+    } else {
+        const auto end = codeStart + method.codeOffset + method.codeSize;
+        if (end < codeStart || end > image->view().size()) {
+            throw std::invalid_argument("code of method " + methodName +
+                                        " out of range");
+        }
+        reader->seek(codeStart + method.codeOffset);
+        decoded = readMethodBody(*reader, methodName, method, classes);
+        if (reader->tell() != end) {
+            throw std::invalid_argument("code size does not match method " +
+                                        methodName);
+        }
+    }
+    decoded.codeOffset = method.codeOffset;
+    decoded.codeSize = method.codeSize;
+    decoded.decoded = true;
+    method = std::move(decoded);
+
+    std::vector<ValueKind> entryStack;
+    if (&method != &mainMethod) {
+        entryStack = method.signature.parameters;
+        entryStack.push_back(ValueKind::Object);
+    }
+    verifyMethod(method, methodName, std::move(entryStack), *this);
+
+    loadStats.methodsDecoded++;
+    loadStats.codeBytesDecoded += method.codeSize;
+    loadStats.instructionsDecoded += method.code.size();
+    loadStats.decodeTime += std::chrono::steady_clock::now() - start;
+}
+
+#if MINIJAVA_VM_PROFILER
+std::unordered_map<std::string_view, std::vector<int>>
+Program::readLines() const {
+    std::unordered_map<std::string_view, std::vector<int>> lines;
+    if (source != nullptr) {
+        for (const auto &method : source->getMethods()) {
+            std::vector<int> methodLines;
+            bool known = false;
+            for (const auto &block : method.getBlocks()) {
+                for (const auto &instruction : block.getInstructions()) {
+                    methodLines.push_back(instruction->getLine());
+                    known = known || methodLines.back() != 0;
+                }
+            }
+            if (known) {
+                lines[method.getName()] = std::move(methodLines);
+            }
+        }
+        return lines;
+    }
+    const auto size = image->view().size();
+    if (linesStart < codeStart || linesStart >= size) {
+        return lines;
+    }
+    try {
+        reader->seek(linesStart);
+        const auto methodCount = reader->readInteger();
+        for (size_t i = 0; i < methodCount; i++) {
+            auto &methodLines = lines[reader->readSymbol()];
+            const auto runs = reader->readInteger();
+            std::int64_t line = 0;
+            for (size_t run = 0; run < runs; run++) {
+                const auto length = reader->readInteger();
+                line += reader->readSignedInteger();
+                // Every instruction takes at least a byte of code.
+                if (length > size - methodLines.size() ||
+                    line < 0 || line > std::numeric_limits<int>::max()) {
+                    return {};
+                }
+                methodLines.insert(methodLines.end(), length,
+                                   static_cast<int>(line));
+            }
+        }
+    } catch (const std::exception &) {
+        return {};
+    }
+    return lines;
+}
+#endif
+
+// Reads a method's entry in the method directory: everything but its body.
+[[nodiscard]] std::pair<std::string_view, Method>
+readMethodEntry(Deserializer &reader, const std::vector<ClassLayout> &classes) {
+    const auto name = reader.readSymbol();
+    Method method;
+    method.classId = reader.readSignedInteger();
+    if (method.classId < 0 ||
+        static_cast<size_t>(method.classId) >= classes.size()) {
+        throw std::out_of_range("class id " + std::to_string(method.classId) +
+                                " out of range in method " +
+                                std::string(name));
+    }
+    method.signature.parameters = reader.readKindVector();
+    const auto resultKinds = reader.readKindVector();
+    if (resultKinds.size() != 1) {
+        throw std::invalid_argument("invalid result kind for method " +
+                                    std::string(name));
+    }
+    method.signature.result = resultKinds.front();
+    method.codeOffset = reader.readInteger();
+    method.codeSize = reader.readInteger();
+    return {name, std::move(method)};
+}
+
+[[nodiscard]] Program
+readProgram(const std::shared_ptr<const BytecodeImage> &image) {
+    const auto readerPointer = std::make_shared<Deserializer>(image->view());
+    auto &reader = *readerPointer;
+    reader.readHeader();
+    reader.readStringTable();
+
+    std::vector<ClassLayout> classes;
+    const auto classCount = reader.readInteger();
+    for (size_t i = 0; i < classCount; i++) {
+        const auto className = reader.readSymbol();
+        auto fields = reader.readSymbolVector();
+        auto fieldKinds = reader.readKindVector();
+        if (fieldKinds.size() != fields.size()) {
+            throw std::invalid_argument(
+                "field kinds do not match fields in class " +
+                std::string(className));
+        }
+        classes.push_back(
+            {className, std::move(fields), std::move(fieldKinds)});
+    }
+
+    const auto methodCount = reader.readInteger();
+    if (methodCount == 0) {
+        throw std::invalid_argument("program has no main method");
+    }
+    auto [mainMethodName, mainMethod] = readMethodEntry(reader, classes);
+    std::unordered_map<std::string_view, Method> methods;
+    for (size_t i = 1; i < methodCount; i++) {
+        auto [name, method] = readMethodEntry(reader, classes);
+        methods.emplace(name, std::move(method));
+    }
+    return Program{image,
+                   readerPointer,
+                   reader.tell(),
+                   std::move(classes),
+                   mainMethodName,
+                   std::move(mainMethod),
+                   std::move(methods)};
+}
+
+// Takes over a program handed over in memory, with the same checks as
+// readProgram but without a bytecode round trip.
+[[nodiscard]] Program convertProgram(const BytecodeProgram &source) {
+    std::vector<ClassLayout> classes;
+    for (const auto &bytecodeClass : source.getClasses()) {
+        const auto &fields = bytecodeClass.getFields();
+        if (bytecodeClass.getFieldKinds().size() != fields.size()) {
+            throw std::invalid_argument(
+                "field kinds do not match fields in class " +
+                bytecodeClass.getName());
+        }
+        classes.push_back({bytecodeClass.getName(),
+                           {fields.begin(), fields.end()},
+                           bytecodeClass.getFieldKinds()});
+    }
+
+    const auto methodEntry = [&classes](const BytecodeMethod &method) {
+        Method entry;
+        entry.classId = method.getClassId();
+        if (entry.classId < 0 ||
+            static_cast<size_t>(entry.classId) >= classes.size()) {
+            throw std::out_of_range("class id " +
+                                    std::to_string(entry.classId) +
+                                    " out of range in method " +
+                                    method.getName());
+        }
+        entry.signature = method.getSignature();
+        entry.source = &method;
+        return entry;
+    };
+    const auto &bytecodeMethods = source.getMethods();
+    if (bytecodeMethods.empty()) {
+        throw std::invalid_argument("program has no main method");
+    }
+    auto mainMethod = methodEntry(bytecodeMethods.front());
+    std::unordered_map<std::string_view, Method> methods;
+    for (size_t i = 1; i < bytecodeMethods.size(); i++) {
+        methods.emplace(bytecodeMethods[i].getName(),
+                        methodEntry(bytecodeMethods[i]));
+    }
+    return Program{source, std::move(classes),
+                   bytecodeMethods.front().getName(), std::move(mainMethod),
+                   std::move(methods)};
+}
+
+// Parses a byte count with an optional K, M or G suffix.
+[[nodiscard]] std::optional<size_t> parseByteSize(std::string_view text) {
+    size_t multiplier = 1;
+    if (!text.empty()) {
+        switch (text.back()) {
+        case 'K':
+        case 'k':
+            multiplier = size_t{1} << 10;
+            break;
+        case 'M':
+        case 'm':
+            multiplier = size_t{1} << 20;
+            break;
+        case 'G':
+        case 'g':
+            multiplier = size_t{1} << 30;
+            break;
+        default:
+            break;
+        }
+        if (multiplier != 1) {
+            text.remove_suffix(1);
+        }
+    }
+    if (text.empty() ||
+        !std::all_of(text.begin(), text.end(),
+                     [](char c) { return c >= '0' && c <= '9'; })) {
+        return std::nullopt;
+    }
+    size_t value = 0;
+    for (const auto c : text) {
+        const auto digit = static_cast<size_t>(c - '0');
+        if (value > (std::numeric_limits<size_t>::max() - digit) / 10) {
+            return std::nullopt;
+        }
+        value = value * 10 + digit;
+    }
+    if (value > std::numeric_limits<size_t>::max() / multiplier) {
+        return std::nullopt;
+    }
+    return value * multiplier;
+}
+
+// Loads the program with load and runs it; source names the program in load
+// errors.
+bool runProgram(const std::function<Program()> &load,
+                const std::string &source, const VmOptions &options,
+                std::ostream &out, std::ostream &err, VmRunStats *stats) {
+    std::optional<Program> program;
+    try {
+        program = load();
+    } catch (const std::exception &exc) {
+        err << "Error: Invalid bytecode " << source << ": " << exc.what()
+            << ".\n";
+        return false;
+    }
+    VM vm(std::move(*program), options.heap, options.jit, options.interpreter,
+          out, err);
+#if MINIJAVA_VM_PROFILER
+    std::optional<PerfCounters> perfCounters;
+    if (options.interpreter.perfCounters) {
+        try {
+            perfCounters.emplace();
+        } catch (const std::exception &exc) {
+            err << "Error: " << exc.what() << ".\n";
+            return false;
+        }
+        vm.measureWith(*perfCounters);
+    }
+#endif
+
+    const auto startAllocations = threadAllocations();
+    const auto startTime = std::chrono::steady_clock::now();
+    bool completed = true;
+    try {
+        vm.run();
+    } catch (const std::exception &exc) {
+        err << "VM threw exception: " << exc.what() << "\n";
+        completed = false;
+    };
+    if (stats != nullptr) {
+        stats->runTime = std::chrono::steady_clock::now() - startTime;
+        stats->completed = completed;
+        vm.getRunStats(*stats);
+        const auto allocations = threadAllocations();
+        stats->hostAllocations = allocations.count - startAllocations.count;
+        stats->hostAllocatedBytes = allocations.bytes - startAllocations.bytes;
+    }
+    if (options.heap.printStats) {
+        vm.printGcStats(err);
+    }
+    if (options.interpreter.printCallStats) {
+        vm.printCallStats(err);
+    }
+    if (options.interpreter.printLoadStats) {
+        vm.printLoadStats(err);
+    }
+#if MINIJAVA_VM_PROFILER
+    if (perfCounters.has_value()) {
+        vm.printPerfCounters(err);
+    }
+    if (options.interpreter.profile) {
+        if (options.interpreter.profilePath.empty()) {
+            vm.printProfile(err);
+        } else if (std::ofstream json(options.interpreter.profilePath);
+                   json.is_open()) {
+            vm.printProfile(err);
+            vm.writeProfileJson(json);
+        } else {
+            err << "Error: Unable to write profile to "
+                << options.interpreter.profilePath << ".\n";
+        }
+    }
+#endif
+#if MINIJAVA_VM_SAMPLER
+    if (const auto &path = options.interpreter.samplePath; !path.empty()) {
+        if (std::ofstream samples(path); samples.is_open()) {
+            vm.writeSamples(samples);
+        } else {
+            err << "Error: Unable to write samples to " << path << ".\n";
+        }
+    }
+#endif
+    return true;
+}
+} // namespace
+
+bool parseVmFlag(std::string_view arg, VmOptions &options) {
+    if (arg == "--gc-stats") {
+        options.heap.printStats = true;
+        return true;
+    }
+    if (constexpr std::string_view heapLimitFlag = "--heap-limit=";
+        arg.starts_with(heapLimitFlag)) {
+        const auto limit = parseByteSize(arg.substr(heapLimitFlag.size()));
+        if (!limit.has_value() || *limit == 0) {
+            throw std::invalid_argument("Invalid heap limit " +
+                                        std::string(arg));
+        }
+        options.heap.limit = *limit;
+        return true;
+    }
+    if (arg == "--load-stats") {
+        options.interpreter.printLoadStats = true;
+        return true;
+    }
+    if (arg == "--call-stats") {
+        options.interpreter.printCallStats = true;
+        return true;
+    }
+    if (arg == "--profile" || arg.starts_with("--profile=")) {
+#if MINIJAVA_VM_PROFILER
+        options.interpreter.profile = true;
+        if (arg != "--profile") {
+            options.interpreter.profilePath = arg.substr(10);
+        }
+        return true;
+#else
+        throw std::invalid_argument("This VM was built without the profiler");
+#endif
+    }
+    if (arg == "--perf-counters" || arg == "--perf-counters=methods") {
+#if MINIJAVA_VM_PROFILER
+        options.interpreter.perfCounters = true;
+        options.interpreter.perMethodCounters = arg != "--perf-counters";
+        return true;
+#else
+        throw std::invalid_argument("This VM was built without the profiler");
+#endif
+    }
+    if (constexpr std::string_view sourceFlag = "--profile-source=";
+        arg.starts_with(sourceFlag)) {
+        options.interpreter.sourcePath = arg.substr(sourceFlag.size());
+        return true;
+    }
+    if (arg.starts_with("--sample=") || arg.starts_with("--sample-interval=")) {
+#if MINIJAVA_VM_SAMPLER
+        const auto value = arg.substr(arg.find('=') + 1);
+        if (arg.starts_with("--sample=")) {
+            if (value.empty()) {
+                throw std::invalid_argument("Missing file name in " +
+                                            std::string(arg));
+            }
+            options.interpreter.samplePath = value;
+            return true;
+        }
+        std::uint32_t interval = 0;
+        const auto [end, ec] = std::from_chars(
+            value.data(), value.data() + value.size(), interval);
+        if (ec != std::errc{} || end != value.data() + value.size() ||
+            interval == 0) {
+            throw std::invalid_argument("Invalid sample interval " +
+                                        std::string(arg));
+        }
+        options.interpreter.sampleInterval =
+            std::chrono::microseconds(interval);
+        return true;
+#else
+        throw std::invalid_argument("This VM was built without sampling");
+#endif
+    }
+    if (arg == "--checked") {
+        options.interpreter.checked = true;
+        return true;
+    }
+    if (arg == "--no-jit") {
+        options.jit.enabled = false;
+        return true;
+    }
+    if (constexpr std::string_view thresholdFlag = "--jit-threshold=";
+        arg.starts_with(thresholdFlag)) {
+        const auto value = arg.substr(thresholdFlag.size());
+        std::uint32_t threshold = 0;
+        const auto [end, ec] = std::from_chars(
+            value.data(), value.data() + value.size(), threshold);
+        if (ec != std::errc{} || end != value.data() + value.size() ||
+            threshold == 0) {
+            throw std::invalid_argument("Invalid JIT threshold " +
+                                        std::string(arg));
+        }
+        options.jit.threshold = threshold;
+        return true;
+    }
+    return false;
+}
+
+bool runBytecodeFile(const std::string &filename, const VmOptions &options,
+                     std::ostream &out, std::ostream &err,
+                     VmRunStats *stats) {
+    const auto image = BytecodeImage::open(filename);
+    if (image == nullptr) {
+        err << "Error: Unable to open file " << filename << ".\n";
+        return false;
+    }
+    return runProgram([&image] { return readProgram(image); },
+                      "file " + filename, options, out, err, stats);
+}
+
+bool runBytecodeProgram(const BytecodeProgram &program,
+                        const VmOptions &options, std::ostream &out,
+                        std::ostream &err, VmRunStats *stats) {
+    // The program is decoded straight from memory, lazily and through the
+    // same linker and verifier as a file.
+    return runProgram([&program] { return convertProgram(program); },
+                      "program", options, out, err, stats);
+}
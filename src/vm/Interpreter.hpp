@@ -0,0 +1,114 @@
+#ifndef VM_INTERPRETER_HPP
+#define VM_INTERPRETER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+class BytecodeProgram;
+
+// Interpreter settings chosen on the command line.
+struct InterpreterOptions {
+    // Keep every runtime check even when the program has been verified. This
+    // also runs without the JIT, whose code has no such checks.
+    bool checked = false;
+    bool printCallStats = false;
+    bool printLoadStats = false;
+    // Count instructions, blocks and calls and report them on exit. The
+    // report also goes to profilePath as JSON when that is set.
+    bool profile = false;
+    std::string profilePath;
+    // The program's source, for the profile's listing of its hottest lines.
+    std::string sourcePath;
+    // Count cycles, instructions, branch and cache misses over the run with
+    // the CPU's performance counters and report them on exit, also per
+    // method with perMethodCounters.
+    bool perfCounters = false;
+    bool perMethodCounters = false;
+    // Count the bytecode instructions executed, for VmRunStats. Like the
+    // profile, this runs without the JIT.
+    bool countInstructions = false;
+    // Record the call stack every sampleInterval of CPU time and write the
+    // stacks to samplePath in collapsed form when the program ends.
+    std::string samplePath;
+    std::chrono::microseconds sampleInterval{1000};
+};
+
+// JIT tier settings chosen on the command line. Without MINIJAVA_VM_JIT
+// they have no effect.
+struct JitOptions {
+    bool enabled = true;
+    // Calls plus backward jumps taken before a method is compiled.
+    std::uint32_t threshold = 100;
+};
+
+// Heap settings chosen on the command line.
+struct HeapOptions {
+    // Largest number of heap bytes the program may keep live; 0 means no
+    // limit.
+    size_t limit = 0;
+    bool printStats = false;
+};
+
+struct VmOptions {
+    HeapOptions heap;
+    JitOptions jit;
+    InterpreterOptions interpreter;
+};
+
+// Command-line flags that parseVmFlag accepts, for usage messages.
+inline constexpr std::string_view vmFlagUsage =
+    "[--gc-stats] [--heap-limit=BYTES[K|M|G]] [--checked] [--call-stats]"
+    " [--load-stats] [--profile[=JSON_FILE]] [--profile-source=FILE]"
+    " [--perf-counters[=methods]] [--sample=FILE]"
+    " [--sample-interval=MICROSECONDS] [--no-jit] [--jit-threshold=N]";
+
+// Applies one command-line flag to options. Returns false if arg is not a VM
+// flag and throws std::invalid_argument if it is one with an invalid value.
+bool parseVmFlag(std::string_view arg, VmOptions &options);
+
+// What a run did, for benchmarks.
+struct VmRunStats {
+    // The time spent running the program, after it was loaded.
+    std::chrono::nanoseconds runTime{0};
+    // False if the program stopped with a runtime error.
+    bool completed = false;
+    // Bytecode instructions executed; 0 unless
+    // InterpreterOptions::countInstructions was set and the VM was built
+    // with MINIJAVA_VM_PROFILER.
+    std::uint64_t instructions = 0;
+    // Times the interpreter continued in JIT-compiled code.
+    std::uint64_t nativeEntries = 0;
+    // The program's own objects and arrays, and the heap they took.
+    std::uint64_t objectsAllocated = 0;
+    std::uint64_t arraysAllocated = 0;
+    std::uint64_t heapBytesAllocated = 0;
+    std::uint64_t peakHeapBytes = 0;
+    std::uint64_t collections = 0;
+    // Calls to operator new made by the VM while the program ran, when the
+    // program counts them (see threadAllocations); zero otherwise.
+    std::uint64_t hostAllocations = 0;
+    std::uint64_t hostAllocatedBytes = 0;
+};
+
+// Both run a program to completion, printing its output to out and runtime
+// errors and requested statistics to err, and fill in stats if given. They
+// return false, after reporting why, only if the program could not be
+// loaded.
+bool runBytecodeFile(const std::string &filename, const VmOptions &options,
+                     std::ostream &out = std::cout,
+                     std::ostream &err = std::cerr,
+                     VmRunStats *stats = nullptr);
+// Runs a freshly compiled program. Its methods are decoded from the program
+// itself rather than from serialized bytecode, so the program must outlive
+// the call.
+bool runBytecodeProgram(const BytecodeProgram &program,
+                        const VmOptions &options,
+                        std::ostream &out = std::cout,
+                        std::ostream &err = std::cerr,
+                        VmRunStats *stats = nullptr);
+
+#endif
@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "util/TimeReport.hpp"
+
+TEST(TimeReport, CountsAllocationsOfNestedPhases) {
+    ASSERT_TRUE(allocationsCounted());
+    TimeReport report;
+    {
+        const TimeReport::Scope outer(&report, "outer");
+        auto first = std::make_unique<int>(1);
+        {
+            const TimeReport::Scope inner(&report, "inner");
+            auto second = std::make_unique<long[]>(8);
+        }
+    }
+    const TimeReport::Scope ignored(nullptr, "not timed");
+
+    const auto &phases = report.getPhases();
+    ASSERT_EQ(phases.size(), 2);
+    EXPECT_EQ(phases[0].name, "outer");
+    EXPECT_EQ(phases[0].depth, 0);
+    EXPECT_EQ(phases[0].allocations.count, 2);
+    EXPECT_EQ(phases[0].allocations.bytes, sizeof(int) + 8 * sizeof(long));
+    EXPECT_EQ(phases[1].name, "inner");
+    EXPECT_EQ(phases[1].depth, 1);
+    EXPECT_EQ(phases[1].allocations.count, 1);
+    EXPECT_GE(phases[0].duration, phases[1].duration);
+    EXPECT_LE(phases[0].start, phases[1].start);
+}
@@ -0,0 +1,306 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast/Node.h"
+#include "bytecode/BytecodeInstruction.hpp"
+#include "bytecode/BytecodeMethod.hpp"
+#include "bytecode/BytecodeProgram.hpp"
+#include "bytecode/Opcode.hpp"
+#include "bytecode/ValueKind.hpp"
+#include "ir/CFG.hpp"
+#include "ir/IRGenerationVisitor.hpp"
+#include "lexing/Diagnostics.hpp"
+#include "lexing/Lexer.hpp"
+#include "lexing/StringViewStream.hpp"
+#include "parsing/Parser.hpp"
+#include "semantic/SymbolTable.hpp"
+#include "semantic/SymbolTableVisitor.hpp"
+#include "semantic/TypeCheckVisitor.hpp"
+#include "util/serialize.hpp"
+
+namespace {
+
+class CollectingDiagnosticSink final : public lexing::DiagnosticSink {
+  public:
+    void emit(lexing::Diagnostic d) override { diagnostics.push_back(d); }
+
+    [[nodiscard]] int error_count() const {
+        int count = 0;
+        for (const auto &d : diagnostics) {
+            if (d.severity == lexing::Severity::Error) {
+                count += 1;
+            }
+        }
+        return count;
+    }
+
+    std::vector<lexing::Diagnostic> diagnostics;
+};
+
+std::unique_ptr<BytecodeProgram> compile(std::string_view source) {
+    CollectingDiagnosticSink diag;
+    auto stream = std::make_unique<lexing::StringViewStream>(source);
+    lexing::Lexer lexer(std::move(stream), source, &diag);
+    parsing::Parser parser(std::move(lexer), &diag);
+    auto parse_result = parser.parse_goal();
+    if (!parse_result.has_value() || diag.error_count() != 0) {
+        ADD_FAILURE() << "parse failed";
+        return nullptr;
+    }
+    auto root = std::move(parse_result.value());
+
+    SymbolTable symbol_table;
+    TypeInfo type_info;
+    if (!build_symbol_table(*root, symbol_table, &diag).ok() ||
+        !check_types(*root, symbol_table, &type_info, &diag).ok()) {
+        ADD_FAILURE() << "semantic analysis failed";
+        return nullptr;
+    }
+
+    CFG graph;
+    graph.setTypeInfo(&type_info);
+    if (!generate_ir(*root, graph, symbol_table, &diag).ok()) {
+        ADD_FAILURE() << "IR generation failed";
+        return nullptr;
+    }
+
+    auto program = std::make_unique<BytecodeProgram>();
+    graph.generateBytecode(*program, symbol_table);
+    return program;
+}
+
+[[nodiscard]] std::vector<const BytecodeInstruction *>
+method_instructions(const BytecodeMethod &method) {
+    std::vector<const BytecodeInstruction *> instructions;
+    for (const auto &block : method.getBlocks()) {
+        for (const auto &instruction : block.getInstructions()) {
+            instructions.push_back(instruction.get());
+        }
+    }
+    return instructions;
+}
+
+constexpr std::string_view counter_source = R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(new Counter().run(3));
+  }
+}
+
+class Counter {
+  int total;
+
+  public int run(int n) {
+    int i;
+    i = 0;
+    total = 0;
+    while (i < n) {
+      total = total + i;
+      i = i + 1;
+    }
+    return total;
+  }
+}
+)";
+
+} // namespace
+
+TEST(BytecodeGeneration, MethodVariablesUseSlotIndexedOpcodes) {
+    auto program = compile(counter_source);
+    ASSERT_NE(program, nullptr);
+
+    auto &method = program->getBytecodeMethod("Counter.run");
+    const auto &variables = method.getVariables();
+    const auto slot_count = static_cast<std::int64_t>(variables.size());
+
+    bool saw_local_load = false;
+    bool saw_local_store = false;
+    for (const auto *instruction : method_instructions(method)) {
+        const auto opcode = instruction->getOpcode();
+        if (opcode == Opcode::LOAD_LOCAL || opcode == Opcode::STORE_LOCAL) {
+            const auto *local =
+                dynamic_cast<const SlotInstruction *>(instruction);
+            ASSERT_NE(local, nullptr);
+            ASSERT_GE(local->getParam(), 0);
+            ASSERT_LT(local->getParam(), slot_count);
+            EXPECT_EQ(variables[static_cast<size_t>(local->getParam())],
+                      local->getName());
+            saw_local_load = saw_local_load || opcode == Opcode::LOAD_LOCAL;
+            saw_local_store = saw_local_store || opcode == Opcode::STORE_LOCAL;
+        }
+    }
+    EXPECT_TRUE(saw_local_load);
+    EXPECT_TRUE(saw_local_store);
+}
+
+TEST(BytecodeGeneration, FieldsUseClassLayoutSlots) {
+    auto program = compile(counter_source);
+    ASSERT_NE(program, nullptr);
+
+    const auto *counter = program->findBytecodeClass("Counter");
+    ASSERT_NE(counter, nullptr);
+    ASSERT_EQ(counter->getFields(), std::vector<std::string>{"total"});
+
+    auto &method = program->getBytecodeMethod("Counter.run");
+    EXPECT_EQ(method.getClassId(), counter->getId());
+    ASSERT_FALSE(method.getVariables().empty());
+    EXPECT_EQ(method.getVariables().front(), "this");
+
+    bool saw_get_field = false;
+    bool saw_put_field = false;
+    for (const auto *instruction : method_instructions(method)) {
+        const auto opcode = instruction->getOpcode();
+        EXPECT_NE(opcode, Opcode::LOAD);
+        EXPECT_NE(opcode, Opcode::STORE);
+        if (opcode == Opcode::GETFIELD || opcode == Opcode::PUTFIELD) {
+            const auto *field =
+                dynamic_cast<const SlotInstruction *>(instruction);
+            ASSERT_NE(field, nullptr);
+            EXPECT_EQ(field->getParam(), 0);
+            EXPECT_EQ(field->getName(), "total");
+            saw_get_field = saw_get_field || opcode == Opcode::GETFIELD;
+            saw_put_field = saw_put_field || opcode == Opcode::PUTFIELD;
+        }
+    }
+    EXPECT_TRUE(saw_get_field);
+    EXPECT_TRUE(saw_put_field);
+}
+
+TEST(BytecodeGeneration, RecordsValueKindsForGarbageCollector) {
+    constexpr std::string_view source = R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(new Holder().fill(new Holder(), 4));
+  }
+}
+
+class Holder {
+  int[] values;
+  Holder other;
+  boolean filled;
+
+  public int fill(Holder next, int size) {
+    values = new int[size];
+    other = next;
+    filled = true;
+    return size;
+  }
+}
+)";
+    auto program = compile(source);
+    ASSERT_NE(program, nullptr);
+
+    const auto *holder = program->findBytecodeClass("Holder");
+    ASSERT_NE(holder, nullptr);
+    const auto &fields = holder->getFields();
+    const auto &fieldKinds = holder->getFieldKinds();
+    ASSERT_EQ(fieldKinds.size(), fields.size());
+    for (size_t i = 0; i < fields.size(); i++) {
+        const auto expected = fields[i] == "values"  ? ValueKind::Array
+                              : fields[i] == "other" ? ValueKind::Object
+                                                     : ValueKind::Integer;
+        EXPECT_EQ(fieldKinds[i], expected) << fields[i];
+    }
+
+    auto &method = program->getBytecodeMethod("Holder.fill");
+    const auto &variables = method.getVariables();
+    const auto &variableKinds = method.getVariableKinds();
+    ASSERT_EQ(variableKinds.size(), variables.size());
+    EXPECT_EQ(variableKinds.front(), ValueKind::Object);
+    for (size_t i = 0; i < variables.size(); i++) {
+        if (variables[i] == "next") {
+            EXPECT_EQ(variableKinds[i], ValueKind::Object);
+        } else if (variables[i] == "size") {
+            EXPECT_EQ(variableKinds[i], ValueKind::Integer);
+        }
+    }
+
+    const auto &signature = method.getSignature();
+    EXPECT_EQ(signature.parameters,
+              (std::vector<ValueKind>{ValueKind::Object, ValueKind::Integer}));
+    EXPECT_EQ(signature.result, ValueKind::Integer);
+}
+
+TEST(BytecodeGeneration, InstructionsCarrySourceLines) {
+    auto program = compile(counter_source);
+    ASSERT_NE(program, nullptr);
+
+    // Counter.run spans lines 10 to 19 of counter_source.
+    std::vector<int> lines;
+    for (const auto *instruction :
+         method_instructions(program->getBytecodeMethod("Counter.run"))) {
+        const auto line = instruction->getLine();
+        EXPECT_GE(line, 10);
+        EXPECT_LE(line, 19);
+        if (instruction->getOpcode() == Opcode::PUTFIELD) {
+            lines.push_back(line);
+        }
+    }
+    // total = 0 and total = total + i.
+    EXPECT_EQ(lines, (std::vector<int>{13, 15}));
+}
+
+TEST(BytecodeGeneration, SerializedProgramStoresEachNameOnce) {
+    auto program = compile(counter_source);
+    ASSERT_NE(program, nullptr);
+
+    std::ostringstream os;
+    program->serialize(os);
+    const auto bytes = os.str();
+    ASSERT_TRUE(bytes.starts_with(bytecodeMagic));
+
+    Deserializer reader(bytes);
+    reader.readHeader();
+    const auto strings = reader.readStringVector();
+    for (const auto *name : {"Counter", "Counter.run", "total", "i"}) {
+        EXPECT_EQ(std::count(strings.begin(), strings.end(), name), 1)
+            << name;
+    }
+    EXPECT_EQ(reader.readInteger(), program->getClasses().size());
+}
+
+TEST(BytecodeGeneration, IntegersUseLeb128) {
+    const std::vector<size_t> unsigned_values = {
+        0, 1, 127, 128, 300, std::numeric_limits<size_t>::max()};
+    const std::vector<std::int64_t> signed_values = {
+        0,
+        -1,
+        63,
+        -64,
+        64,
+        -65,
+        std::numeric_limits<std::int64_t>::min(),
+        std::numeric_limits<std::int64_t>::max()};
+
+    std::ostringstream os;
+    Serializer serializer(os);
+    serializer.writeInteger(127);
+    serializer.writeSignedInteger(-64);
+    EXPECT_EQ(os.str().size(), 2);
+    for (const auto value : unsigned_values) {
+        serializer.writeInteger(value);
+    }
+    for (const auto value : signed_values) {
+        serializer.writeSignedInteger(value);
+    }
+
+    const auto bytes = os.str();
+    Deserializer reader(bytes);
+    EXPECT_EQ(reader.readInteger(), 127);
+    EXPECT_EQ(reader.readSignedInteger(), -64);
+    for (const auto value : unsigned_values) {
+        EXPECT_EQ(reader.readInteger(), value);
+    }
+    for (const auto value : signed_values) {
+        EXPECT_EQ(reader.readSignedInteger(), value);
+    }
+    EXPECT_EQ(reader.tell(), bytes.size());
+    EXPECT_THROW((void)reader.readInteger(), std::out_of_range);
+}
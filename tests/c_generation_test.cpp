@@ -0,0 +1,322 @@
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ast/Node.h"
+#include "codegen/NativeCompiler.hpp"
+#include "driver/CompilationSession.hpp"
+#include "ir/CFG.hpp"
+#include "ir/IRGenerationVisitor.hpp"
+#include "lexing/Diagnostics.hpp"
+#include "lexing/Lexer.hpp"
+#include "lexing/StringViewStream.hpp"
+#include "parsing/Parser.hpp"
+#include "semantic/SymbolTable.hpp"
+#include "semantic/SymbolTableVisitor.hpp"
+#include "semantic/TypeCheckVisitor.hpp"
+#include "vm/Interpreter.hpp"
+
+namespace fs = std::filesystem;
+
+extern char **environ;
+
+namespace {
+
+class CollectingDiagnosticSink final : public lexing::DiagnosticSink {
+  public:
+    void emit(lexing::Diagnostic d) override { diagnostics.push_back(d); }
+
+    [[nodiscard]] int error_count() const {
+        int count = 0;
+        for (const auto &d : diagnostics) {
+            if (d.severity == lexing::Severity::Error) {
+                count += 1;
+            }
+        }
+        return count;
+    }
+
+    std::vector<lexing::Diagnostic> diagnostics;
+};
+
+std::optional<std::string> compile_to_c(std::string_view source) {
+    CollectingDiagnosticSink diag;
+    auto stream = std::make_unique<lexing::StringViewStream>(source);
+    lexing::Lexer lexer(std::move(stream), source, &diag);
+    parsing::Parser parser(std::move(lexer), &diag);
+    auto parse_result = parser.parse_goal();
+    if (!parse_result.has_value() || diag.error_count() != 0) {
+        ADD_FAILURE() << "parse failed";
+        return std::nullopt;
+    }
+    auto root = std::move(parse_result.value());
+
+    SymbolTable symbol_table;
+    TypeInfo type_info;
+    if (!build_symbol_table(*root, symbol_table, &diag).ok() ||
+        !check_types(*root, symbol_table, &type_info, &diag).ok()) {
+        ADD_FAILURE() << "semantic analysis failed";
+        return std::nullopt;
+    }
+
+    CFG graph;
+    graph.setTypeInfo(&type_info);
+    if (!generate_ir(*root, graph, symbol_table, &diag).ok()) {
+        ADD_FAILURE() << "IR generation failed";
+        return std::nullopt;
+    }
+
+    std::ostringstream os;
+    graph.generateC(os, symbol_table);
+    return os.str();
+}
+
+// A directory of the running test's own under the temporary directory,
+// removed when the test ends. ctest runs each test in its own process, so
+// tests sharing paths would overwrite each other's files.
+class TestDirectory {
+  public:
+    TestDirectory() {
+        const auto *info =
+            testing::UnitTest::GetInstance()->current_test_info();
+        path_ = fs::path(testing::TempDir()) /
+                (std::string("c_generation_test_") + info->name());
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+    TestDirectory(const TestDirectory &) = delete;
+    TestDirectory &operator=(const TestDirectory &) = delete;
+    ~TestDirectory() {
+        std::error_code error;
+        fs::remove_all(path_, error);
+    }
+
+    [[nodiscard]] const fs::path &path() const { return path_; }
+
+  private:
+    fs::path path_;
+};
+
+// Runs argv without a shell, with standard output and error going to
+// output_path. Returns the exit status, or nullopt when the program could not
+// be started or did not exit normally.
+std::optional<int> run_program(std::vector<std::string> argv,
+                               const fs::path &output_path) {
+    std::vector<char *> args;
+    for (auto &arg : argv) {
+        args.push_back(arg.data());
+    }
+    args.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO,
+                                     output_path.c_str(),
+                                     O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    pid_t pid = 0;
+    const int spawned = posix_spawnp(&pid, args[0], &actions, nullptr,
+                                     args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (spawned != 0) {
+        return std::nullopt;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) {
+            return std::nullopt;
+        }
+    }
+    if (!WIFEXITED(status)) {
+        return std::nullopt;
+    }
+    return WEXITSTATUS(status);
+}
+
+bool have_c_compiler(const fs::path &directory) {
+    auto command = nativeCompilerCommand();
+    command.emplace_back("--version");
+    return run_program(std::move(command), directory / "cc_version.out") == 0;
+}
+
+std::string read_file(const fs::path &path) {
+    std::ifstream file(path);
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+}
+
+// Builds the translation unit with the system C compiler and returns what
+// the program printed, or nullopt when there is no C compiler to use.
+std::optional<std::string> run_native(const std::string &c_source) {
+    const TestDirectory directory;
+    if (!have_c_compiler(directory.path())) {
+        return std::nullopt;
+    }
+    const auto c_path = directory.path() / "prog.c";
+    const auto executable = directory.path() / "prog";
+    const auto output_path = directory.path() / "prog.out";
+    std::ofstream(c_path) << c_source;
+
+    EXPECT_TRUE(compileNative(c_path, executable)) << c_source;
+    EXPECT_TRUE(run_program({executable.string()}, output_path).has_value());
+    return read_file(output_path);
+}
+
+constexpr std::string_view counter_source = R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(new Counter().run(4));
+  }
+}
+
+class Counter {
+  int total;
+  int[] squares;
+
+  public int run(int n) {
+    int i;
+    i = 0;
+    total = 0;
+    squares = new int[n];
+    while (i < n) {
+      squares[i] = i * i;
+      total = total + squares[i];
+      i = i + 1;
+    }
+    System.out.println(squares.length);
+    return total;
+  }
+}
+)";
+
+} // namespace
+
+TEST(CGeneration, ClassesBecomeStructsAndMethodsFunctions) {
+    const auto c_source = compile_to_c(counter_source);
+    ASSERT_TRUE(c_source.has_value());
+
+    EXPECT_NE(c_source->find("struct mj_class_Counter {"), std::string::npos);
+    EXPECT_NE(c_source->find("int64_t f_total;"), std::string::npos);
+    EXPECT_NE(c_source->find("mj_array *f_squares;"), std::string::npos);
+    EXPECT_NE(c_source->find("static int64_t mj_7Counter_run("
+                             "struct mj_class_Counter *self, int64_t v_n)"),
+              std::string::npos);
+    EXPECT_NE(c_source->find("self->f_total = "), std::string::npos);
+    EXPECT_NE(c_source->find("mj_store(self->f_squares, "), std::string::npos);
+    EXPECT_NE(c_source->find("int main(void)"), std::string::npos);
+}
+
+TEST(CGeneration, NativeProgramPrintsLikeTheVm) {
+    const auto c_source = compile_to_c(counter_source);
+    ASSERT_TRUE(c_source.has_value());
+
+    const auto output = run_native(*c_source);
+    if (!output.has_value()) {
+        GTEST_SKIP() << "no C compiler available";
+    }
+    EXPECT_EQ(*output, "4\n14\n");
+}
+
+TEST(CGeneration, NativeArrayAccessIsBoundsChecked) {
+    constexpr std::string_view source = R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(new Reader().read(3));
+  }
+}
+
+class Reader {
+  public int read(int index) {
+    int[] values;
+    values = new int[3];
+    System.out.println(1);
+    return values[index];
+  }
+}
+)";
+    const auto c_source = compile_to_c(source);
+    ASSERT_TRUE(c_source.has_value());
+
+    const auto output = run_native(*c_source);
+    if (!output.has_value()) {
+        GTEST_SKIP() << "no C compiler available";
+    }
+    EXPECT_EQ(*output, "1\nerror: array index out of bounds\n");
+}
+
+TEST(CGeneration, NativeCompilerTakesPathsLiterally) {
+    const auto c_source = compile_to_c(counter_source);
+    ASSERT_TRUE(c_source.has_value());
+    const TestDirectory test_directory;
+    if (!have_c_compiler(test_directory.path())) {
+        GTEST_SKIP() << "no C compiler available";
+    }
+
+    // A batch compile names output directories after the input files.
+    const auto directory =
+        test_directory.path() / "a$(touch INJECTED) `touch INJECTED2` b";
+    fs::create_directories(directory);
+    const auto c_path = directory / "prog.c";
+    const auto executable = directory / "prog";
+    std::ofstream(c_path) << *c_source;
+
+    EXPECT_TRUE(compileNative(c_path, executable));
+    EXPECT_TRUE(fs::exists(executable));
+    EXPECT_FALSE(fs::exists("INJECTED"));
+    EXPECT_FALSE(fs::exists("INJECTED2"));
+    EXPECT_FALSE(compileNative(directory / "missing.c", executable));
+}
+
+TEST(CGeneration, NativeDivisionFailsLikeTheVm) {
+    constexpr std::string_view source = R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(new Divider().run(0));
+  }
+}
+
+class Divider {
+  public int run(int zero) {
+    int min;
+    min = 0 - 2147483647 - 1;
+    min = min * min;
+    min = 0 - min - min;
+    System.out.println(this.divide(min, zero - 1));
+    System.out.println(this.divide(7, 2));
+    return this.divide(10, zero);
+  }
+
+  public int divide(int a, int b) {
+    return a / b;
+  }
+}
+)";
+    CompilationSession session{std::string(source)};
+    ASSERT_EQ(session.compile(), CompileStatus::Success);
+    std::ostringstream vm_out;
+    std::ostringstream vm_err;
+    ASSERT_TRUE(runBytecodeProgram(session.getProgram(), VmOptions{}, vm_out,
+                                   vm_err));
+    EXPECT_EQ(vm_out.str(), "-9223372036854775808\n3\n");
+    EXPECT_EQ(vm_err.str(), "VM threw exception: division by zero\n");
+
+    const auto c_source = compile_to_c(source);
+    ASSERT_TRUE(c_source.has_value());
+    const auto output = run_native(*c_source);
+    if (!output.has_value()) {
+        GTEST_SKIP() << "no C compiler available";
+    }
+    // The same output and the same error, under each backend's prefix.
+    EXPECT_EQ(*output, vm_out.str() + "error: division by zero\n");
+}
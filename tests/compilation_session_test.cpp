@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "driver/CompilationSession.hpp"
+
+namespace {
+
+std::string load_file(const std::filesystem::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    EXPECT_TRUE(in.is_open()) << "Failed to open file: " << path;
+    return {std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>()};
+}
+
+std::string valid_file(const std::string &name) {
+    return load_file(std::filesystem::path(TEST_FILES_ROOT) / "valid" / name);
+}
+
+} // namespace
+
+TEST(CompilationSession, CompilesToBytecodeInMemory) {
+    CompilationSession session(valid_file("Factorial.java"));
+    EXPECT_EQ(session.compile(), CompileStatus::Success);
+    EXPECT_TRUE(session.succeeded());
+    EXPECT_TRUE(session.getDiagnostics().empty());
+    ASSERT_NE(session.getRoot(), nullptr);
+    EXPECT_EQ(session.serialize().substr(0, 4), "MJBC");
+}
+
+TEST(CompilationSession, ReportsThePhaseThatFailed) {
+    CompilationSession syntax("public class Main {");
+    EXPECT_EQ(syntax.compile(), CompileStatus::SyntaxError);
+    EXPECT_FALSE(syntax.getDiagnostics().empty());
+
+    CompilationSession types(R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(true + 1);
+  }
+}
+)");
+    EXPECT_EQ(types.compile(), CompileStatus::TypeError);
+    EXPECT_FALSE(types.succeeded());
+    ASSERT_FALSE(types.getDiagnostics().empty());
+    EXPECT_EQ(types.getDiagnostics().front().severity,
+              lexing::Severity::Error);
+}
+
+TEST(CompilationSession, IndependentSessionsCompileConcurrently) {
+    const std::vector<std::string> names = {
+        "BinarySearch.java", "BinaryTree.java", "BubbleSort.java",
+        "LinkedList.java", "QuickSort.java"};
+    std::vector<std::string> sources;
+    std::vector<std::string> expected;
+    for (const auto &name : names) {
+        sources.push_back(valid_file(name));
+        CompilationSession session(sources.back());
+        ASSERT_EQ(session.compile(), CompileStatus::Success) << name;
+        expected.push_back(session.serialize());
+    }
+
+    constexpr size_t threadCount = 8;
+    std::vector<std::vector<std::string>> results(threadCount);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t] {
+            for (int round = 0; round < 4; round++) {
+                for (const auto &source : sources) {
+                    CompilationSession session(source);
+                    (void)session.compile();
+                    results[t].push_back(session.serialize());
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (const auto &result : results) {
+        ASSERT_EQ(result.size(), 4 * sources.size());
+        for (size_t i = 0; i < result.size(); i++) {
+            EXPECT_EQ(result[i], expected[i % sources.size()]);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#if __has_include(<unistd.h>)
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+#include "driver/Server.hpp"
+
+namespace {
+
+constexpr std::string_view program = R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(6 * 7);
+  }
+}
+)";
+
+std::string request(std::string_view command, std::string_view source) {
+    return std::string(command) + " " + std::to_string(source.size()) + "\n" +
+           std::string(source);
+}
+
+// Serves the given requests and returns everything written in response.
+std::string serve(const std::string &requests, bool &ok) {
+    FILE *in = std::tmpfile();
+    FILE *out = std::tmpfile();
+    std::fwrite(requests.data(), 1, requests.size(), in);
+    std::fflush(in);
+    std::rewind(in);
+    ok = serveConnection(fileno(in), fileno(out), VmOptions{});
+
+    std::string response;
+    std::rewind(out);
+    char buffer[4096];
+    size_t count = 0;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), out)) != 0) {
+        response.append(buffer, count);
+    }
+    std::fclose(in);
+    std::fclose(out);
+    return response;
+}
+
+} // namespace
+
+TEST(Server, AnswersEachRequestInOrder) {
+    bool ok = false;
+    const auto response =
+        serve(request("run", program) + request("compile", "class {") +
+                  request("compile", program),
+              ok);
+    EXPECT_TRUE(ok);
+
+    const std::string syntaxError =
+        "Error on line 1: syntax error, unexpected CLASS, expecting PUBLIC.\n";
+    const std::string expectedStart =
+        "0 3 0 0\n42\n2 0 " + std::to_string(syntaxError.size()) + " 0\n" +
+        syntaxError + "0 0 0 ";
+    ASSERT_TRUE(response.starts_with(expectedStart)) << response;
+
+    // The last response carries the program's bytecode.
+    const auto newline = response.find('\n', expectedStart.size());
+    ASSERT_NE(newline, std::string::npos);
+    const auto bytecode = response.substr(newline + 1);
+    EXPECT_EQ(response.substr(expectedStart.size(),
+                              newline - expectedStart.size()),
+              std::to_string(bytecode.size()));
+    EXPECT_TRUE(bytecode.starts_with("MJBC"));
+}
+
+TEST(Server, RejectsMalformedRequests) {
+    bool ok = true;
+    EXPECT_EQ(serve("compile x\n", ok),
+              "1 0 26 0\nError: Malformed request.\n");
+    EXPECT_FALSE(ok);
+    EXPECT_EQ(serve("", ok), "");
+    EXPECT_TRUE(ok);
+}
+#endif
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "driver/CompilationSession.hpp"
+#include "util/TimeReport.hpp"
+
+TEST(TimeReport, CountsNoAllocationsWithoutCountingNew) {
+    EXPECT_FALSE(allocationsCounted());
+    const auto before = threadAllocations();
+    auto value = std::make_unique<int>(1);
+    EXPECT_EQ(threadAllocations().count, before.count);
+
+    TimeReport report;
+    {
+        const TimeReport::Scope phase(&report, "phase");
+        auto other = std::make_unique<int>(2);
+    }
+    std::ostringstream table;
+    report.print(table);
+    EXPECT_NE(table.str().find("phase"), std::string::npos);
+    EXPECT_NE(table.str().find(" -"), std::string::npos);
+    std::ostringstream trace;
+    report.writeChromeTrace(trace);
+    EXPECT_EQ(trace.str().find("allocations"), std::string::npos);
+}
+
+TEST(TimeReport, TimesEachCompilerPhase) {
+    CompilationSession session(R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(1 + 2);
+  }
+}
+)");
+    TimeReport report;
+    ASSERT_EQ(session.compile(&report), CompileStatus::Success);
+
+    std::string names;
+    for (const auto &phase : report.getPhases()) {
+        names += std::string(phase.depth, '>') + phase.name + " ";
+    }
+    EXPECT_EQ(names, "parse >lex build_symbol_table check_types generate_ir "
+                     "ir_passes >constant-folding >conditional-jump-folding "
+                     "generate_bytecode ");
+
+    std::ostringstream trace;
+    report.writeChromeTrace(trace);
+    EXPECT_TRUE(trace.str().starts_with("{\"traceEvents\":[\n{\"name\":"
+                                        "\"parse\",\"ph\":\"X\""));
+}
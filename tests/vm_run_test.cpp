@@ -0,0 +1,498 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "bytecode/BytecodeMethod.hpp"
+#include "bytecode/BytecodeMethodBlock.hpp"
+#include "bytecode/BytecodeProgram.hpp"
+#include "bytecode/ValueKind.hpp"
+#include "driver/CompilationSession.hpp"
+#include "vm/Interpreter.hpp"
+
+namespace {
+
+std::unique_ptr<CompilationSession> compile(std::string_view source) {
+    auto session = std::make_unique<CompilationSession>(std::string(source));
+    if (session->compile() != CompileStatus::Success) {
+        ADD_FAILURE() << "compilation failed";
+        return nullptr;
+    }
+    return session;
+}
+
+constexpr std::string_view counter_source = R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(new Counter().run(4));
+  }
+}
+
+class Counter {
+  int total;
+  int[] squares;
+
+  public int run(int n) {
+    int i;
+    i = 0;
+    total = 0;
+    squares = new int[n];
+    while (i < n) {
+      squares[i] = i * i;
+      total = total + squares[i];
+      i = i + 1;
+    }
+    System.out.println(squares.length);
+    return total;
+  }
+}
+)";
+
+} // namespace
+
+TEST(VmRun, RunsCompiledProgramInProcess) {
+    const auto session = compile(counter_source);
+    ASSERT_NE(session, nullptr);
+
+    for (const bool checked : {false, true}) {
+        VmOptions options;
+        options.interpreter.checked = checked;
+        testing::internal::CaptureStdout();
+        EXPECT_TRUE(runBytecodeProgram(session->getProgram(), options));
+        EXPECT_EQ(testing::internal::GetCapturedStdout(), "4\n14\n");
+    }
+}
+
+TEST(VmRun, RejectsProgramWithoutMain) {
+    const BytecodeProgram program;
+    std::ostringstream out;
+    std::ostringstream err;
+    EXPECT_FALSE(runBytecodeProgram(program, VmOptions{}, out, err));
+    EXPECT_EQ(err.str(), "Error: Invalid bytecode program: program has no "
+                         "main method.\n");
+}
+
+TEST(VmRun, ReportsRuntimeErrors) {
+    constexpr std::string_view source = R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(new Reader().read(3));
+  }
+}
+
+class Reader {
+  public int read(int index) {
+    int[] values;
+    values = new int[3];
+    System.out.println(1);
+    return values[index];
+  }
+}
+)";
+    const auto session = compile(source);
+    ASSERT_NE(session, nullptr);
+
+    testing::internal::CaptureStdout();
+    testing::internal::CaptureStderr();
+    EXPECT_TRUE(runBytecodeProgram(session->getProgram(), VmOptions{}));
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "1\n");
+    EXPECT_EQ(testing::internal::GetCapturedStderr(),
+              "VM threw exception: array index out of bounds\n");
+}
+
+TEST(VmRun, ParsesVmFlags) {
+    VmOptions options;
+    EXPECT_TRUE(parseVmFlag("--heap-limit=2K", options));
+    EXPECT_EQ(options.heap.limit, 2048);
+    EXPECT_TRUE(parseVmFlag("--no-jit", options));
+    EXPECT_FALSE(options.jit.enabled);
+    EXPECT_FALSE(parseVmFlag("--emit=c", options));
+    EXPECT_THROW((void)parseVmFlag("--jit-threshold=0", options),
+                 std::invalid_argument);
+}
+
+TEST(VmRun, ProfilesMethodsAndOpcodes) {
+    const auto session = compile(counter_source);
+    ASSERT_NE(session, nullptr);
+
+    VmOptions options;
+    try {
+        ASSERT_TRUE(parseVmFlag("--profile", options));
+    } catch (const std::invalid_argument &) {
+        GTEST_SKIP() << "built without MINIJAVA_VM_PROFILER";
+    }
+    std::ostringstream out;
+    std::ostringstream err;
+    EXPECT_TRUE(runBytecodeProgram(session->getProgram(), options, out, err));
+    EXPECT_EQ(out.str(), "4\n14\n");
+
+    const auto report = err.str();
+    EXPECT_NE(report.find(" instructions executed\n"), std::string::npos);
+    // Counter.run is called once and does most of the work, so it comes
+    // before main, which includes it.
+    const auto run = report.find("Counter.run\n");
+    const auto main = report.find("Main.main\n");
+    ASSERT_NE(run, std::string::npos);
+    ASSERT_NE(main, std::string::npos);
+    EXPECT_LT(run, main);
+    EXPECT_NE(report.find("100.0  Main.main\n"), std::string::npos);
+    EXPECT_NE(report.find("IMUL\n"), std::string::npos);
+    EXPECT_NE(report.find("Hottest blocks:\n"), std::string::npos);
+    // The compiler's line table attributes the loop body to its lines.
+    EXPECT_NE(report.find("Hottest lines:\n"), std::string::npos);
+    EXPECT_NE(report.find("  Counter.run:17\n"), std::string::npos);
+    EXPECT_NE(report.find("  Counter.run:18\n"), std::string::npos);
+}
+
+TEST(VmRun, SamplesCallStacks) {
+    constexpr std::string_view source = R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(new Work().outer(400));
+  }
+}
+
+class Work {
+  public int outer(int n) {
+    int i;
+    int total;
+    i = 0;
+    total = 0;
+    while (i < n) {
+      total = total + this.inner(i);
+      i = i + 1;
+    }
+    return total;
+  }
+
+  public int inner(int n) {
+    int j;
+    int total;
+    j = 0;
+    total = 0;
+    while (j < 2000) {
+      total = total + n;
+      j = j + 1;
+    }
+    return total;
+  }
+}
+)";
+    const auto session = compile(source);
+    ASSERT_NE(session, nullptr);
+
+    const auto unique_suffix = std::to_string(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("minijava_samples_" + unique_suffix + ".txt");
+    VmOptions options;
+    try {
+        ASSERT_TRUE(parseVmFlag("--sample=" + path.string(), options));
+    } catch (const std::invalid_argument &) {
+        GTEST_SKIP() << "built without MINIJAVA_VM_PROFILER";
+    }
+    ASSERT_TRUE(parseVmFlag("--sample-interval=100", options));
+    // Keep the loops in the interpreter so the run takes long enough for
+    // the timer to tick.
+    options.jit.enabled = false;
+    std::ostringstream out;
+    std::ostringstream err;
+    EXPECT_TRUE(runBytecodeProgram(session->getProgram(), options, out, err));
+    EXPECT_EQ(out.str(), "159600000\n");
+    EXPECT_EQ(err.str(), "");
+
+    std::ifstream samples(path);
+    ASSERT_TRUE(samples.is_open());
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(samples, line)) {
+        lines++;
+        EXPECT_TRUE(line.starts_with("Main.main;Work.outer")) << line;
+        const auto space = line.rfind(' ');
+        ASSERT_NE(space, std::string::npos) << line;
+        EXPECT_GT(std::stoul(line.substr(space + 1)), 0) << line;
+    }
+    EXPECT_GT(lines, 0);
+    samples.close();
+
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    EXPECT_FALSE(error);
+    EXPECT_THROW((void)parseVmFlag("--sample-interval=0", options),
+                 std::invalid_argument);
+}
+
+TEST(VmRun, ReadsPerformanceCounters) {
+    const auto session = compile(counter_source);
+    ASSERT_NE(session, nullptr);
+
+    VmOptions options;
+    try {
+        ASSERT_TRUE(parseVmFlag("--perf-counters=methods", options));
+    } catch (const std::invalid_argument &) {
+        GTEST_SKIP() << "built without MINIJAVA_VM_PROFILER";
+    }
+    EXPECT_TRUE(options.interpreter.perMethodCounters);
+    std::ostringstream out;
+    std::ostringstream err;
+    if (!runBytecodeProgram(session->getProgram(), options, out, err)) {
+        // Containers and most virtual machines have no PMU to count with.
+        EXPECT_TRUE(err.str().starts_with("Error: hardware performance"))
+            << err.str();
+        EXPECT_EQ(out.str(), "");
+        GTEST_SKIP() << err.str();
+    }
+    EXPECT_EQ(out.str(), "4\n14\n");
+    EXPECT_TRUE(err.str().starts_with("Performance counters:\n")) << err.str();
+    EXPECT_NE(err.str().find("bytecode instructions:"), std::string::npos);
+    EXPECT_NE(err.str().find("  Counter.run\n"), std::string::npos);
+    EXPECT_NE(err.str().find("  Main.main\n"), std::string::npos);
+}
+
+TEST(VmRun, ReportsRunStats) {
+    const auto session = compile(counter_source);
+    ASSERT_NE(session, nullptr);
+
+    VmOptions options;
+    options.interpreter.countInstructions = true;
+    std::ostringstream out;
+    std::ostringstream err;
+    VmRunStats stats;
+    EXPECT_TRUE(runBytecodeProgram(session->getProgram(), options, out, err,
+                                   &stats));
+    EXPECT_EQ(out.str(), "4\n14\n");
+    EXPECT_TRUE(stats.completed);
+    EXPECT_GT(stats.runTime.count(), 0);
+    EXPECT_EQ(stats.objectsAllocated, 1);
+    EXPECT_EQ(stats.arraysAllocated, 1);
+    EXPECT_GT(stats.heapBytesAllocated, 4 * sizeof(std::int64_t));
+    EXPECT_EQ(stats.peakHeapBytes, stats.heapBytesAllocated);
+    EXPECT_EQ(stats.collections, 0);
+
+    VmOptions probe;
+    try {
+        (void)parseVmFlag("--profile", probe);
+        EXPECT_GT(stats.instructions, 0);
+    } catch (const std::invalid_argument &) {
+        EXPECT_EQ(stats.instructions, 0);
+    }
+
+    const auto error = compile(R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(new int[2][5]);
+  }
+}
+)");
+    ASSERT_NE(error, nullptr);
+    EXPECT_TRUE(runBytecodeProgram(error->getProgram(), VmOptions{}, out, err,
+                                   &stats));
+    EXPECT_FALSE(stats.completed);
+}
+
+TEST(VmRun, ChecksDivision) {
+    constexpr std::string_view source = R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(new Divider().run(3));
+  }
+}
+
+class Divider {
+  public int run(int n) {
+    int min;
+    System.out.println(this.sum(100, n));
+    // INT64_MIN, from -2^31 squared.
+    min = 0 - 2147483647 - 1;
+    min = min * min;
+    min = 0 - min - min;
+    System.out.println(this.divide(min, 0 - 1));
+    return this.divide(10, n - n);
+  }
+
+  // Both divide in a loop, so that the JIT runs the division.
+  public int sum(int a, int n) {
+    int i;
+    int total;
+    i = 0;
+    total = 0;
+    while (i < n) {
+      total = total + a / (n - i);
+      i = i + 1;
+    }
+    return total;
+  }
+
+  public int divide(int a, int b) {
+    int i;
+    int quotient;
+    i = 0;
+    quotient = 0;
+    while (i < 2) {
+      quotient = a / b;
+      i = i + 1;
+    }
+    return quotient;
+  }
+}
+)";
+    const auto session = compile(source);
+    ASSERT_NE(session, nullptr);
+
+    // Interpreted, and compiled from the first call where there is a JIT.
+    for (const bool jit : {false, true}) {
+        VmOptions options;
+        options.jit.enabled = jit;
+        ASSERT_TRUE(parseVmFlag("--jit-threshold=1", options));
+        std::ostringstream out;
+        std::ostringstream err;
+        VmRunStats stats;
+        EXPECT_TRUE(runBytecodeProgram(session->getProgram(), options, out,
+                                       err, &stats));
+        EXPECT_EQ(out.str(), "183\n-9223372036854775808\n") << jit;
+        EXPECT_EQ(err.str(), "VM threw exception: division by zero\n") << jit;
+#if MINIJAVA_VM_JIT
+        EXPECT_EQ(stats.nativeEntries > 0, jit);
+#endif
+    }
+}
+
+TEST(VmRun, EntersJitCodeOnlyWhereItRuns) {
+    // Every method calls or returns within a few instructions, so compiled
+    // code would be left as soon as it was entered.
+    const auto calls = compile(R"(public class Main {
+  public static void main(String[] args) {
+    System.out.println(new Calls().fib(15));
+  }
+}
+
+class Calls {
+  int one;
+
+  public int fib(int n) {
+    int result;
+    if (n < 2) {
+      result = this.getOne();
+    } else {
+      result = this.fib(n - 1) + this.fib(n - 2);
+    }
+    return result;
+  }
+
+  public int getOne() {
+    one = 1;
+    return one;
+  }
+}
+)");
+    ASSERT_NE(calls, nullptr);
+    const auto loops = compile(counter_source);
+    ASSERT_NE(loops, nullptr);
+
+    VmOptions options;
+    ASSERT_TRUE(parseVmFlag("--jit-threshold=1", options));
+    std::ostringstream out;
+    std::ostringstream err;
+    VmRunStats stats;
+    EXPECT_TRUE(
+        runBytecodeProgram(calls->getProgram(), options, out, err, &stats));
+    EXPECT_EQ(out.str(), "987\n");
+    // Without entries the JIT run is the interpreted run, so it is no slower
+    // than --no-jit.
+    EXPECT_EQ(stats.nativeEntries, 0);
+
+    EXPECT_TRUE(
+        runBytecodeProgram(loops->getProgram(), options, out, err, &stats));
+    EXPECT_EQ(err.str(), "");
+#if MINIJAVA_VM_JIT
+    EXPECT_GT(stats.nativeEntries, 0);
+#else
+    EXPECT_EQ(stats.nativeEntries, 0);
+#endif
+}
+
+TEST(VmRun, RunsOnlyVerifiedCodeCompiled) {
+    // Loop.count loops 1000 times. Unless verifiable, it also has a path,
+    // never taken, that calls a method that does not exist, which the
+    // verifier rejects.
+    const auto build = [](bool verifiable) {
+        using enum ValueKind;
+        auto program = std::make_unique<BytecodeProgram>();
+        // Like the code generator, add every class before taking references,
+        // and finish each method before adding the next.
+        program->addBytecodeClass("Main", {}, {});
+        program->addBytecodeClass("Loop", {}, {});
+        auto &main =
+            program->addBytecodeMethod("Main.main", {"this", "loop"},
+                                       {Object, Object}, {},
+                                       *program->findBytecodeClass("Main"));
+        main.addBytecodeMethodBlock("Main.main")
+            .new_object("Loop")
+            .store("loop")
+            .push(1000)
+            .push("loop")
+            .call("Loop.count")
+            .write()
+            .stop();
+        auto &count = program->addBytecodeMethod(
+            "Loop.count", {"this", "i", "n"}, {Object, Integer, Integer},
+            {.parameters = {Integer}, .result = Integer},
+            *program->findBytecodeClass("Loop"));
+        count.addBytecodeMethodBlock("Loop.count")
+            .store("this")
+            .store("n")
+            .push(0)
+            .store("i")
+            .jump("head");
+        count.addBytecodeMethodBlock("head")
+            .push("i")
+            .push("n")
+            .less_than()
+            .cjump("done")
+            .jump("body");
+        count.addBytecodeMethodBlock("body")
+            .push("i")
+            .push(1)
+            .add()
+            .store("i")
+            .jump("head");
+        count.addBytecodeMethodBlock("done")
+            .push("i")
+            .push(0)
+            .less_than()
+            .cjump("finish")
+            .jump("negative");
+        auto &negative = count.addBytecodeMethodBlock("negative");
+        if (verifiable) {
+            negative.push(0).ret();
+        } else {
+            negative.push("this").call("Nowhere.method").ret();
+        }
+        count.addBytecodeMethodBlock("finish").push("i").ret();
+        return program;
+    };
+
+    for (const bool verifiable : {true, false}) {
+        for (const bool checked : {false, true}) {
+            const auto program = build(verifiable);
+            VmOptions options;
+            options.interpreter.checked = checked;
+            ASSERT_TRUE(parseVmFlag("--jit-threshold=1", options));
+            std::ostringstream out;
+            std::ostringstream err;
+            VmRunStats stats;
+            EXPECT_TRUE(
+                runBytecodeProgram(*program, options, out, err, &stats));
+            EXPECT_EQ(out.str(), "1000\n");
+            EXPECT_EQ(err.str(), "");
+#if MINIJAVA_VM_JIT
+            EXPECT_EQ(stats.nativeEntries > 0, verifiable && !checked)
+                << verifiable << checked;
+#else
+            EXPECT_EQ(stats.nativeEntries, 0);
+#endif
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "util/WorkStealing.hpp"
+
+TEST(WorkStealing, RunsEveryTaskOnce) {
+    for (const unsigned threads : {1U, 2U, 7U, 64U}) {
+        constexpr size_t count = 1000;
+        std::vector<std::atomic<int>> runs(count);
+        runWorkStealing(count, threads, [&](size_t i) { runs[i] += 1; });
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(runs[i].load(), 1) << "task " << i << ", " << threads
+                                         << " threads";
+        }
+    }
+    runWorkStealing(0, 4, [](size_t) { FAIL() << "no tasks to run"; });
+}
+
+TEST(WorkStealing, FinishesOtherTasksBeforeRethrowing) {
+    std::atomic<int> finished = 0;
+    EXPECT_THROW(runWorkStealing(100, 4,
+                                 [&](size_t i) {
+                                     if (i == 3) {
+                                         throw std::runtime_error("task 3");
+                                     }
+                                     finished += 1;
+                                 }),
+                 std::runtime_error);
+    EXPECT_EQ(finished.load(), 99);
+}